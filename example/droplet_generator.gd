@@ -47,23 +47,31 @@ func get_num_droplets() -> int:
 # Called every physics frame. 'delta' is the elapsed time since the previous frame.
 func _physics_process(delta: float) -> void:
 	_elapsed_time += delta
-	# Check if we should generate a new droplet
-	if _elapsed_time >= generation_interval and _num_droplets < droplets_to_generate:
+	# Work out how many droplets are due this frame
+	var droplets_due: int = 0
+	while _elapsed_time >= generation_interval and _num_droplets + droplets_due < droplets_to_generate:
 		_elapsed_time = _elapsed_time - generation_interval
-		_generate_droplet()
-
-# Generates a droplet from a scene.
-func _generate_droplet()  -> void:
-	# Create the appropriate droplet type
-	var droplet_node: RigidBody3D = _droplet_scene.instantiate()
-	# Add the droplet to the scene
-	fluid_server.add_child(droplet_node)
-	droplet_node.owner = fluid_server.owner
-	# Set the droplet's position
-	droplet_node.position = Vector3(randf_range(-1.0, 1.0),
-									randf_range(-1.0, 1.0),
-									randf_range(-1.0, 1.0))
-	# Add the droplet to the server
-	fluid_server.add_droplet(droplet_node)
+		droplets_due += 1
+	# Generate them all at once
+	if droplets_due > 0:
+		_generate_droplets(droplets_due)
+
+# Generates a number of droplets from a scene and adds them to the server in one batch.
+func _generate_droplets(count: int) -> void:
+	var droplet_nodes: Array[DropletBody3D] = []
+	droplet_nodes.resize(count)
+	for i in count:
+		# Create the appropriate droplet type
+		var droplet_node: DropletBody3D = _droplet_scene.instantiate()
+		# Add the droplet to the scene
+		fluid_server.add_child(droplet_node)
+		droplet_node.owner = fluid_server.owner
+		# Set the droplet's position
+		droplet_node.position = Vector3(randf_range(-1.0, 1.0),
+										randf_range(-1.0, 1.0),
+										randf_range(-1.0, 1.0))
+		droplet_nodes[i] = droplet_node
+	# Add the droplets to the server
+	fluid_server.add_droplet_bodies(droplet_nodes)
 	# Increment current number of droplets
-	_num_droplets += 1
+	_num_droplets += count
@@ -0,0 +1,474 @@
+// A standalone benchmark for the fluid core, built without Godot (see the "benchmark" target in SConstruct).
+//
+// Each benchmark runs on synthetic droplet clouds of 1k to 100k droplets, spread uniformly through a cube sized to
+// give a target number of neighbors per droplet. The output follows the layout of Google Benchmark, with the time
+// per iteration, the time per droplet, and (where it applies) the number of droplet pairs tested per second.
+//
+// Usage: fluid_benchmark [--filter=<substring>] [--min_time=<seconds>] [--format=console|csv]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <functional>
+
+#include "vec3.h"
+#include "spatial_hash_grid.h"
+#include "cohesion_kernel.h"
+#include "neighbor_table.h"
+#include "connected_components.h"
+#include "cohesion_solver.h"
+
+
+
+// Settings
+
+// The distance that the attraction force is effective over (the same default as FluidServer)
+static const float EFFECTIVE_DISTANCE = 0.5;
+
+// Pi (M_PI is not standard)
+static const float PI = 3.14159265358979f;
+
+// The magnitude of the attraction force (the same default as FluidServer)
+static const float FORCE_MAGNITUDE = 25.0;
+
+// The droplet counts to run each benchmark at
+static const size_t DROPLET_COUNTS[] = {1000, 10000, 100000};
+
+// A named density, given as the average number of droplets within the effective distance of each droplet
+struct Density
+{
+	const char* name;
+	float neighbors;
+};
+static const Density DENSITIES[] = {{"sparse", 4.0}, {"medium", 16.0}, {"dense", 48.0}};
+
+// The command line options
+struct Options
+{
+	std::string filter;
+	double min_time = 0.5;
+	bool csv = false;
+};
+
+
+
+// Droplet Clouds
+
+// A cloud of droplets, stored the same way FluidServer stores them
+struct DropletCloud
+{
+	std::string name;
+	std::vector<float> x, y, z;
+	size_t size() const { return x.size(); }
+	Vec3 position(size_t i) const { return Vec3(x[i], y[i], z[i]); }
+};
+
+// Makes a cloud of droplets spread uniformly through a cube (with a fixed seed, so every run sees the same cloud)
+static DropletCloud make_cloud(size_t droplet_count, const Density& density)
+{
+	DropletCloud cloud;
+	cloud.name = std::to_string(droplet_count) + "/" + density.name;
+	// Size the cube so that a sphere of the effective distance holds the requested number of droplets on average
+	float sphere_volume = 4.0 / 3.0 * PI * EFFECTIVE_DISTANCE * EFFECTIVE_DISTANCE * EFFECTIVE_DISTANCE;
+	float side = std::cbrt(droplet_count * sphere_volume / density.neighbors);
+	std::mt19937 generator(12345);
+	std::uniform_real_distribution<float> distribution(-0.5 * side, 0.5 * side);
+	cloud.x.resize(droplet_count);
+	cloud.y.resize(droplet_count);
+	cloud.z.resize(droplet_count);
+	for (size_t i = 0; i < droplet_count; ++i)
+	{
+		cloud.x[i] = distribution(generator);
+		cloud.y[i] = distribution(generator);
+		cloud.z[i] = distribution(generator);
+	}
+	return cloud;
+}
+
+// Sorts a cloud into a grid, the same way FluidServer does every physics frame
+static void build_grid(const DropletCloud& cloud, SpatialHashGrid& grid)
+{
+	grid.reset(EFFECTIVE_DISTANCE, cloud.size());
+	for (size_t i = 0; i < cloud.size(); ++i)
+	{
+		grid.set_point(i, cloud.position(i));
+	}
+	grid.build();
+}
+
+// Counts the number of pairs the pair loop tests (every droplet against every droplet in its surrounding buckets)
+static size_t count_candidate_pairs(const DropletCloud& cloud, const SpatialHashGrid& grid)
+{
+	size_t pair_count = 0;
+	for (size_t i = 0; i < cloud.size(); ++i)
+	{
+		uint32_t buckets[SpatialHashGrid::MAX_NEIGHBOR_BUCKETS];
+		size_t bucket_count = grid.find_neighbor_buckets(cloud.position(i), buckets);
+		for (size_t b = 0; b < bucket_count; ++b)
+		{
+			pair_count += grid.get_bucket_end(buckets[b]) - grid.get_bucket_start(buckets[b]);
+		}
+	}
+	return pair_count;
+}
+
+// Collects every pair of droplets within the effective distance, each pair once
+static void collect_edges(const DropletCloud& cloud, const SpatialHashGrid& grid, std::vector<NeighborTable::Edge>& edges)
+{
+	float radius_squared = EFFECTIVE_DISTANCE * EFFECTIVE_DISTANCE;
+	const uint32_t* sorted_points = grid.get_sorted_points();
+	edges.clear();
+	for (uint32_t a = 0; a < cloud.size(); ++a)
+	{
+		Vec3 position = cloud.position(a);
+		uint32_t buckets[SpatialHashGrid::MAX_NEIGHBOR_BUCKETS];
+		size_t bucket_count = grid.find_neighbor_buckets(position, buckets);
+		for (size_t i = 0; i < bucket_count; ++i)
+		{
+			for (uint32_t j = grid.get_bucket_start(buckets[i]); j < grid.get_bucket_end(buckets[i]); ++j)
+			{
+				uint32_t b = sorted_points[j];
+				float distance_squared = position.distance_squared(cloud.position(b));
+				if (b > a && distance_squared < radius_squared)
+				{
+					edges.push_back({a, b, distance_squared});
+				}
+			}
+		}
+	}
+}
+
+
+
+// Harness
+
+// Keeps the compiler from throwing away results that are never used
+static volatile float g_sink = 0.0;
+
+// The columns of one benchmark result
+struct BenchmarkResult
+{
+	std::string name;
+	double ns_per_iteration;
+	size_t iterations;
+	double ns_per_droplet;
+	double pairs_per_second;
+};
+
+// Prints the header for the chosen format
+static void print_header(const Options& options)
+{
+	if (options.csv)
+	{
+		std::printf("name,iterations,ns_per_iteration,ns_per_droplet,pairs_per_second\n");
+	}
+	else
+	{
+		std::printf("%-48s %14s %10s %12s %12s\n", "Benchmark", "Time", "Iterations", "ns/droplet", "pairs/s");
+		std::printf("%s\n", std::string(100, '-').c_str());
+	}
+}
+
+// Prints one result in the chosen format
+static void print_result(const Options& options, const BenchmarkResult& result)
+{
+	if (options.csv)
+	{
+		std::printf("%s,%zu,%.1f,%.3f,%.0f\n", result.name.c_str(), result.iterations, result.ns_per_iteration,
+			result.ns_per_droplet, result.pairs_per_second);
+		return;
+	}
+	char pairs[32] = "";
+	if (result.pairs_per_second >= 1e9)
+		std::snprintf(pairs, sizeof(pairs), "%.3fG", result.pairs_per_second / 1e9);
+	else if (result.pairs_per_second >= 1e6)
+		std::snprintf(pairs, sizeof(pairs), "%.3fM", result.pairs_per_second / 1e6);
+	else if (result.pairs_per_second > 0.0)
+		std::snprintf(pairs, sizeof(pairs), "%.0f", result.pairs_per_second);
+	std::printf("%-48s %11.0f ns %10zu %12.2f %12s\n", result.name.c_str(), result.ns_per_iteration, result.iterations,
+		result.ns_per_droplet, pairs);
+	std::fflush(stdout);
+}
+
+// Runs a benchmark (unless filtered out) until it has taken at least the minimum time, then prints the result
+static void run_benchmark(const Options& options, const std::string& name, size_t droplet_count, size_t pairs_per_iteration,
+	const std::function<void()>& iteration)
+{
+	if (!options.filter.empty() && name.find(options.filter) == std::string::npos)
+		return;
+	using Clock = std::chrono::steady_clock;
+	// Warm up caches and branch predictors
+	iteration();
+	// Double the number of iterations until a batch takes long enough to measure
+	size_t iterations = 1;
+	double elapsed_ns = 0.0;
+	while (true)
+	{
+		Clock::time_point start = Clock::now();
+		for (size_t i = 0; i < iterations; ++i)
+		{
+			iteration();
+		}
+		elapsed_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+		if (elapsed_ns >= options.min_time * 1e9 || iterations >= (size_t(1) << 30))
+			break;
+		iterations *= 2;
+	}
+	BenchmarkResult result;
+	result.name = name;
+	result.iterations = iterations;
+	result.ns_per_iteration = elapsed_ns / iterations;
+	result.ns_per_droplet = result.ns_per_iteration / droplet_count;
+	result.pairs_per_second = pairs_per_iteration > 0 ? pairs_per_iteration / (result.ns_per_iteration * 1e-9) : 0.0;
+	print_result(options, result);
+}
+
+
+
+// Benchmarks
+
+// Rebuilds the grid and finds the candidates near every droplet (the neighbor search part of the physics frame)
+static void benchmark_neighbor_search(const Options& options, const DropletCloud& cloud)
+{
+	SpatialHashGrid grid;
+	build_grid(cloud, grid);
+	size_t pair_count = count_candidate_pairs(cloud, grid);
+	run_benchmark(options, "neighbor_search/" + cloud.name, cloud.size(), pair_count, [&cloud, &grid] ()
+	{
+		build_grid(cloud, grid);
+		float radius_squared = EFFECTIVE_DISTANCE * EFFECTIVE_DISTANCE;
+		const float* sorted_x = grid.get_sorted_x();
+		const float* sorted_y = grid.get_sorted_y();
+		const float* sorted_z = grid.get_sorted_z();
+		uint32_t neighbor_count = 0;
+		for (size_t a = 0; a < cloud.size(); ++a)
+		{
+			Vec3 position = cloud.position(a);
+			uint32_t buckets[SpatialHashGrid::MAX_NEIGHBOR_BUCKETS];
+			size_t bucket_count = grid.find_neighbor_buckets(position, buckets);
+			for (size_t i = 0; i < bucket_count; ++i)
+			{
+				for (uint32_t j = grid.get_bucket_start(buckets[i]); j < grid.get_bucket_end(buckets[i]); ++j)
+				{
+					float dx = sorted_x[j] - position.x;
+					float dy = sorted_y[j] - position.y;
+					float dz = sorted_z[j] - position.z;
+					neighbor_count += (dx * dx + dy * dy + dz * dz) < radius_squared;
+				}
+			}
+		}
+		g_sink = g_sink + neighbor_count;
+	});
+}
+
+// Sums the cohesive force on every droplet with the vectorized kernel (the gather pair loop, on one thread)
+static void benchmark_force_accumulation(const Options& options, const DropletCloud& cloud, CohesionKernelIsa isa,
+	CohesionKernelPrecision precision, const char* precision_name)
+{
+	// Skip instruction sets this CPU does not support
+	if (cohesion_kernel_set_isa(isa) != isa)
+		return;
+	SpatialHashGrid grid;
+	build_grid(cloud, grid);
+	size_t pair_count = count_candidate_pairs(cloud, grid);
+	std::vector<float> distances_squared;
+	std::vector<Vec3> forces(cloud.size());
+	std::string name = std::string("force_accumulation/") + cohesion_kernel_get_isa_name(isa) + "/" + precision_name + "/" + cloud.name;
+	SpatialHashGrid::NeighborCandidates candidates;
+	run_benchmark(options, name, cloud.size(), pair_count, [&cloud, &grid, &distances_squared, &forces, &candidates, precision] ()
+	{
+		float radius_squared = EFFECTIVE_DISTANCE * EFFECTIVE_DISTANCE;
+		candidates.is_valid = false;
+		for (size_t a = 0; a < cloud.size(); ++a)
+		{
+			// The points in the surrounding cells are copied into one run, just like in the solver
+			Vec3 position = cloud.position(a);
+			grid.gather_neighbor_candidates(position, candidates);
+			distances_squared.resize(candidates.size());
+			Vec3 force = Vec3::ZERO;
+			cohesion_kernel_accumulate(candidates.x.data(), candidates.y.data(), candidates.z.data(), candidates.size(),
+				position, radius_squared, FORCE_MAGNITUDE, precision, distances_squared.data(), force);
+			forces[a] = force;
+		}
+		g_sink = g_sink + forces[0].x;
+	});
+}
+
+// Builds the neighbor table and groups the droplets into connected components (the grouping part of solidify())
+static void benchmark_freeze_grouping(const Options& options, const DropletCloud& cloud)
+{
+	SpatialHashGrid grid;
+	build_grid(cloud, grid);
+	std::vector<NeighborTable::Edge> edges;
+	collect_edges(cloud, grid, edges);
+	NeighborTable table;
+	ConnectedComponents components;
+	std::vector<Vec3> centers;
+	run_benchmark(options, "freeze_grouping/" + cloud.name, cloud.size(), edges.size(), [&cloud, &edges, &table, &components, &centers] ()
+	{
+		table.reset(cloud.size(), 1);
+		for (const NeighborTable::Edge& edge : edges)
+		{
+			table.add_edge(0, edge.point_a, edge.point_b, edge.distance_squared);
+		}
+		table.build();
+		components.build(cloud.size(), table.get_edges());
+		components.compute_centers(cloud.x.data(), cloud.y.data(), cloud.z.data(), centers);
+		g_sink = g_sink + components.get_component_count();
+	});
+}
+
+// Runs a whole liquid physics frame through the solver (grid, parallel pair loop, and optionally the neighbor table),
+// the same way FluidServer does, minus reading the positions from and applying the forces to the physics server
+static void benchmark_solver_step(const Options& options, const DropletCloud& cloud, CohesionAccumulationMode accumulation_mode,
+	bool record_neighbors, float verlet_skin = 0.0, uint32_t domain_count = 1)
+{
+	CohesionSolver solver;
+	solver.set_force_magnitude(FORCE_MAGNITUDE);
+	solver.set_effective_distance(EFFECTIVE_DISTANCE);
+	solver.set_accumulation_mode(accumulation_mode);
+	solver.set_verlet_skin(verlet_skin);
+	// Every domain attracts every other one as strongly as itself, so the pairs are the same as with one domain
+	solver.set_domain_count(domain_count);
+	for (uint32_t domain_a = 0; domain_a < domain_count; ++domain_a)
+	{
+		for (uint32_t domain_b = 0; domain_b < domain_count; ++domain_b)
+		{
+			solver.set_domain_interaction(domain_a, domain_b, 1.0);
+		}
+	}
+	solver.reserve(cloud.size());
+	for (size_t i = 0; i < cloud.size(); ++i)
+	{
+		solver.add_point(cloud.position(i), i % domain_count);
+	}
+	SpatialHashGrid grid;
+	build_grid(cloud, grid);
+	size_t pair_count = count_candidate_pairs(cloud, grid);
+	std::string name = std::string("solver_step/") + (accumulation_mode == COHESION_ACCUMULATION_MODE_LOCKED ? "locked" : "gather")
+		+ (record_neighbors ? "+neighbors" : "") + (verlet_skin > 0.0 ? "+verlet" : "") + (domain_count > 1 ? "+domains/" : "/") + cloud.name;
+	run_benchmark(options, name, cloud.size(), pair_count, [&solver, record_neighbors] ()
+	{
+		solver.update_grid();
+		solver.accumulate_forces(record_neighbors);
+		if (record_neighbors)
+			solver.build_neighbor_table();
+		g_sink = g_sink + solver.get_force(0).x;
+	});
+}
+
+// Sorts the droplets along a Morton curve the way FluidServer does every so often, then runs a physics frame on
+// the sorted droplets (the clouds are in random order, so compare it with solver_step/gather)
+static void benchmark_spatial_sort(const Options& options, const DropletCloud& cloud)
+{
+	CohesionSolver solver;
+	solver.set_force_magnitude(FORCE_MAGNITUDE);
+	solver.set_effective_distance(EFFECTIVE_DISTANCE);
+	solver.reserve(cloud.size());
+	for (size_t i = 0; i < cloud.size(); ++i)
+	{
+		solver.add_point(cloud.position(i));
+	}
+	// After the first iteration the points are already sorted, which only skips the final shuffle
+	run_benchmark(options, "spatial_sort/" + cloud.name, cloud.size(), cloud.size(), [&solver] ()
+	{
+		g_sink = g_sink + solver.sort_points_spatially()[0];
+	});
+	SpatialHashGrid grid;
+	build_grid(cloud, grid);
+	size_t pair_count = count_candidate_pairs(cloud, grid);
+	run_benchmark(options, "solver_step/gather+sorted/" + cloud.name, cloud.size(), pair_count, [&solver] ()
+	{
+		solver.update_grid();
+		solver.accumulate_forces(false);
+		g_sink = g_sink + solver.get_force(0).x;
+	});
+}
+
+// Runs the Vec3 operations the scalar pair loop uses (subtract, length, normalize, scale, add) on every droplet
+static void benchmark_vec3_math(const Options& options, const DropletCloud& cloud)
+{
+	run_benchmark(options, "vec3_math/" + cloud.name, cloud.size(), cloud.size(), [&cloud] ()
+	{
+		Vec3 center = cloud.position(0);
+		Vec3 sum = Vec3::ZERO;
+		for (size_t i = 1; i < cloud.size(); ++i)
+		{
+			Vec3 offset = cloud.position(i) - center;
+			if (offset.length_squared() > 0.0)
+			{
+				sum += FORCE_MAGNITUDE * offset.normalized();
+			}
+		}
+		g_sink = g_sink + sum.dot(Vec3(1.0, 1.0, 1.0));
+	});
+}
+
+
+
+// Main
+
+// Reads the command line options, printing the usage and exiting if any are not recognized
+static Options parse_options(int argc, char** argv)
+{
+	Options options;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strncmp(argv[i], "--filter=", 9) == 0)
+			options.filter = argv[i] + 9;
+		else if (std::strncmp(argv[i], "--min_time=", 11) == 0)
+			options.min_time = std::atof(argv[i] + 11);
+		else if (std::strcmp(argv[i], "--format=csv") == 0)
+			options.csv = true;
+		else if (std::strcmp(argv[i], "--format=console") == 0)
+			options.csv = false;
+		else
+		{
+			std::fprintf(stderr, "Usage: %s [--filter=<substring>] [--min_time=<seconds>] [--format=console|csv]\n", argv[0]);
+			std::exit(1);
+		}
+	}
+	return options;
+}
+
+int main(int argc, char** argv)
+{
+	Options options = parse_options(argc, argv);
+	CohesionKernelIsa best_isa = cohesion_kernel_get_isa();
+	if (!options.csv)
+	{
+		std::printf("Kernel instruction set: %s\n\n", cohesion_kernel_get_isa_name(best_isa));
+	}
+	print_header(options);
+	for (size_t droplet_count : DROPLET_COUNTS)
+	{
+		for (const Density& density : DENSITIES)
+		{
+			DropletCloud cloud = make_cloud(droplet_count, density);
+			benchmark_neighbor_search(options, cloud);
+			// Every instruction set at the default precision, then the other precisions on the best one
+			for (int isa = COHESION_KERNEL_ISA_SCALAR; isa <= best_isa; ++isa)
+			{
+				benchmark_force_accumulation(options, cloud, CohesionKernelIsa(isa), COHESION_KERNEL_PRECISION_REFINED, "refined");
+			}
+			benchmark_force_accumulation(options, cloud, best_isa, COHESION_KERNEL_PRECISION_EXACT, "exact");
+			benchmark_force_accumulation(options, cloud, best_isa, COHESION_KERNEL_PRECISION_FAST, "fast");
+			cohesion_kernel_set_isa(best_isa);
+			benchmark_solver_step(options, cloud, COHESION_ACCUMULATION_MODE_GATHER, false);
+			benchmark_solver_step(options, cloud, COHESION_ACCUMULATION_MODE_GATHER, true);
+			benchmark_solver_step(options, cloud, COHESION_ACCUMULATION_MODE_LOCKED, false);
+			// The cloud never moves, so this only measures reusing the cached pairs
+			benchmark_solver_step(options, cloud, COHESION_ACCUMULATION_MODE_GATHER, false, 0.1);
+			benchmark_solver_step(options, cloud, COHESION_ACCUMULATION_MODE_GATHER, false, 0.0, 2);
+			benchmark_spatial_sort(options, cloud);
+			benchmark_freeze_grouping(options, cloud);
+			benchmark_vec3_math(options, cloud);
+		}
+	}
+	return 0;
+}
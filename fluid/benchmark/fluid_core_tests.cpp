@@ -0,0 +1,316 @@
+// Headless checks for the fluid core, built without Godot (see the "test" target in SConstruct).
+//
+// Each check compares a fast path against a plain one on synthetic droplet clouds: the vectorized kernels
+// against the scalar kernel, the pair loop modes against each other, the union-find components against a
+// breadth-first search, and the Morton sort against the order it reports. Exits with 1 if any check fails.
+//
+// Usage: fluid_core_tests
+
+#include <cstdio>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "vec3.h"
+#include "cohesion_kernel.h"
+#include "neighbor_table.h"
+#include "connected_components.h"
+#include "morton_order.h"
+#include "cohesion_solver.h"
+
+
+
+// Settings
+
+// The distance that the attraction force is effective over (the same default as FluidServer)
+static const float EFFECTIVE_DISTANCE = 0.5;
+
+// The magnitude of the attraction force (the same default as FluidServer)
+static const float FORCE_MAGNITUDE = 25.0;
+
+// The number of droplets in the clouds the solver is checked on, and the side of the cube they fill
+static const size_t DROPLET_COUNT = 4000;
+static const float CLOUD_SIDE = 4.0;
+
+// The number of checks that have failed so far
+static int g_failure_count = 0;
+
+
+
+// Helpers
+
+// Reports the result of one check
+static void check(bool passed, const std::string& name, const std::string& details = "")
+{
+	std::printf("%s  %s%s%s\n", passed ? "PASS" : "FAIL", name.c_str(), details.empty() ? "" : "  ", details.c_str());
+	if (!passed)
+		++g_failure_count;
+}
+
+// Formats an error for a check's details
+static std::string format_error(float error)
+{
+	char buffer[32];
+	std::snprintf(buffer, sizeof(buffer), "%.2e", error);
+	return buffer;
+}
+
+// Gets the largest difference between two forces, relative to the size of the larger one (or 1 if both are small)
+static float relative_difference(const Vec3& a, const Vec3& b)
+{
+	float scale = std::max(1.0f, std::max(a.length(), b.length()));
+	return (a - b).length() / scale;
+}
+
+// Makes a cloud of points spread uniformly through a cube (with a fixed seed, so every run sees the same cloud)
+static std::vector<Vec3> make_cloud(size_t point_count, float side, unsigned seed)
+{
+	std::mt19937 generator(seed);
+	std::uniform_real_distribution<float> distribution(0.0, side);
+	std::vector<Vec3> cloud(point_count);
+	for (Vec3& position : cloud)
+	{
+		position = Vec3(distribution(generator), distribution(generator), distribution(generator));
+	}
+	return cloud;
+}
+
+// Makes a solver holding a cloud, with the given pair loop settings
+static void fill_solver(CohesionSolver& solver, const std::vector<Vec3>& cloud, CohesionAccumulationMode accumulation_mode,
+	float verlet_skin, size_t thread_count)
+{
+	solver.set_effective_distance(EFFECTIVE_DISTANCE);
+	solver.set_force_magnitude(FORCE_MAGNITUDE);
+	solver.set_accumulation_mode(accumulation_mode);
+	solver.set_kernel_precision(COHESION_KERNEL_PRECISION_EXACT);
+	solver.set_verlet_skin(verlet_skin);
+	solver.set_thread_count(thread_count);
+	for (const Vec3& position : cloud)
+	{
+		solver.add_point(position);
+	}
+}
+
+
+
+// Checks
+
+// Every vectorized kernel matches the scalar one at each precision, for every leftover count of candidates
+static void check_kernels()
+{
+	const CohesionKernelPrecision precisions[] = {COHESION_KERNEL_PRECISION_EXACT, COHESION_KERNEL_PRECISION_REFINED, COHESION_KERNEL_PRECISION_FAST};
+	const char* precision_names[] = {"exact", "refined", "fast"};
+	// How far each precision may stray from the exact result (12 bits of the raw estimate, with room to spare)
+	const float tolerances[] = {1e-5f, 1e-4f, 4e-3f};
+	CohesionKernelIsa best_isa = cohesion_kernel_get_isa();
+	std::vector<Vec3> candidates = make_cloud(67, 2.0 * EFFECTIVE_DISTANCE, 1);
+	std::vector<float> x, y, z;
+	for (const Vec3& candidate : candidates)
+	{
+		x.push_back(candidate.x);
+		y.push_back(candidate.y);
+		z.push_back(candidate.z);
+	}
+	Vec3 position(EFFECTIVE_DISTANCE, EFFECTIVE_DISTANCE, EFFECTIVE_DISTANCE);
+	// One candidate sits exactly on the position, which the kernels must skip
+	x[5] = position.x;
+	y[5] = position.y;
+	z[5] = position.z;
+	float radius_squared = EFFECTIVE_DISTANCE * EFFECTIVE_DISTANCE;
+	for (int isa = COHESION_KERNEL_ISA_SSE2; isa <= best_isa; ++isa)
+	{
+		for (size_t p = 0; p < 3; ++p)
+		{
+			float worst_force = 0.0f;
+			float worst_distance = 0.0f;
+			for (size_t count = 0; count <= candidates.size(); ++count)
+			{
+				std::vector<float> expected_distances(count), distances(count);
+				Vec3 expected = Vec3::ZERO, force = Vec3::ZERO;
+				cohesion_kernel_set_isa(COHESION_KERNEL_ISA_SCALAR);
+				cohesion_kernel_accumulate(x.data(), y.data(), z.data(), count, position, radius_squared, FORCE_MAGNITUDE,
+					COHESION_KERNEL_PRECISION_EXACT, expected_distances.data(), expected);
+				cohesion_kernel_set_isa(CohesionKernelIsa(isa));
+				cohesion_kernel_accumulate(x.data(), y.data(), z.data(), count, position, radius_squared, FORCE_MAGNITUDE,
+					precisions[p], distances.data(), force);
+				worst_force = std::max(worst_force, relative_difference(expected, force) / FORCE_MAGNITUDE);
+				for (size_t i = 0; i < count; ++i)
+				{
+					worst_distance = std::max(worst_distance, std::fabs(expected_distances[i] - distances[i]));
+				}
+			}
+			std::string name = std::string("kernel/") + cohesion_kernel_get_isa_name(CohesionKernelIsa(isa)) + "/" + precision_names[p];
+			check(worst_force <= tolerances[p] && worst_distance <= 1e-6f, name,
+				"force error " + format_error(worst_force) + ", distance error " + format_error(worst_distance));
+		}
+	}
+	cohesion_kernel_set_isa(best_isa);
+}
+
+// The gather, locked, and Verlet pair loops find the same forces and the same nearby pairs
+static void check_pair_loops()
+{
+	std::vector<Vec3> cloud = make_cloud(DROPLET_COUNT, CLOUD_SIDE, 2);
+	CohesionSolver reference;
+	fill_solver(reference, cloud, COHESION_ACCUMULATION_MODE_GATHER, 0.0, 1);
+	reference.step(true);
+	struct Mode
+	{
+		const char* name;
+		CohesionAccumulationMode accumulation_mode;
+		float verlet_skin;
+		size_t thread_count;
+	};
+	const Mode modes[] = {
+		{"gather/4-threads", COHESION_ACCUMULATION_MODE_GATHER, 0.0, 4},
+		{"locked", COHESION_ACCUMULATION_MODE_LOCKED, 0.0, 1},
+		{"locked/4-threads", COHESION_ACCUMULATION_MODE_LOCKED, 0.0, 4},
+		{"verlet", COHESION_ACCUMULATION_MODE_GATHER, 0.1, 1}
+	};
+	for (const Mode& mode : modes)
+	{
+		CohesionSolver solver;
+		fill_solver(solver, cloud, mode.accumulation_mode, mode.verlet_skin, mode.thread_count);
+		solver.step(true);
+		float worst_force = 0.0f;
+		for (uint32_t i = 0; i < DROPLET_COUNT; ++i)
+		{
+			worst_force = std::max(worst_force, relative_difference(reference.get_force(i), solver.get_force(i)));
+		}
+		bool same_edges = solver.get_neighbor_table().get_edge_count() == reference.get_neighbor_table().get_edge_count();
+		for (uint32_t i = 0; i < DROPLET_COUNT && same_edges; ++i)
+		{
+			std::vector<uint32_t> expected, found;
+			reference.get_neighbor_table().get_sorted_neighbors(i, expected);
+			solver.get_neighbor_table().get_sorted_neighbors(i, found);
+			std::sort(expected.begin(), expected.end());
+			std::sort(found.begin(), found.end());
+			same_edges = expected == found;
+		}
+		check(worst_force <= 1e-4f && same_edges, std::string("pair_loop/") + mode.name,
+			"force error " + format_error(worst_force) + ", edges " + std::to_string(solver.get_neighbor_table().get_edge_count()));
+	}
+}
+
+// The union-find components group the points the same way a breadth-first search over the neighbor table does
+static void check_components()
+{
+	// Sparse enough to split into many groups
+	std::vector<Vec3> cloud = make_cloud(DROPLET_COUNT, 2.5 * CLOUD_SIDE, 3);
+	CohesionSolver solver;
+	fill_solver(solver, cloud, COHESION_ACCUMULATION_MODE_GATHER, 0.0, 1);
+	solver.step(true, true);
+	const NeighborTable& neighbor_table = solver.get_neighbor_table();
+	const ConnectedComponents& components = solver.get_components();
+	// Label each point with the first point its search reached from
+	std::vector<uint32_t> search_labels(DROPLET_COUNT, UINT32_MAX);
+	size_t search_count = 0;
+	for (uint32_t start = 0; start < DROPLET_COUNT; ++start)
+	{
+		if (search_labels[start] != UINT32_MAX)
+			continue;
+		++search_count;
+		std::vector<uint32_t> queue(1, start);
+		search_labels[start] = start;
+		for (size_t next = 0; next < queue.size(); ++next)
+		{
+			const uint32_t* neighbors = neighbor_table.get_neighbors(queue[next]);
+			for (uint32_t i = 0; i < neighbor_table.get_neighbor_count(queue[next]); ++i)
+			{
+				if (search_labels[neighbors[i]] == UINT32_MAX)
+				{
+					search_labels[neighbors[i]] = start;
+					queue.push_back(neighbors[i]);
+				}
+			}
+		}
+	}
+	// Two points share a component exactly when they share a search label, and each component's members agree
+	std::vector<uint32_t> component_labels(components.get_component_count(), UINT32_MAX);
+	bool matches = components.get_component_count() == search_count;
+	for (uint32_t i = 0; i < DROPLET_COUNT && matches; ++i)
+	{
+		uint32_t component = components.get_component(i);
+		if (component_labels[component] == UINT32_MAX)
+			component_labels[component] = search_labels[i];
+		matches = component_labels[component] == search_labels[i];
+	}
+	size_t member_total = 0;
+	for (uint32_t component = 0; component < components.get_component_count() && matches; ++component)
+	{
+		const uint32_t* members = components.get_members(component);
+		for (uint32_t i = 0; i < components.get_member_count(component); ++i)
+		{
+			matches = matches && components.get_component(members[i]) == component;
+		}
+		member_total += components.get_member_count(component);
+	}
+	check(matches && member_total == DROPLET_COUNT, "components/union_find_matches_search",
+		std::to_string(search_count) + " groups");
+}
+
+// The Morton order is a permutation, and sorting the solver by it moves every point (and its force) along with it
+static void check_morton_order()
+{
+	std::vector<Vec3> cloud = make_cloud(DROPLET_COUNT, CLOUD_SIDE, 4);
+	std::vector<float> x, y, z;
+	for (const Vec3& position : cloud)
+	{
+		x.push_back(position.x);
+		y.push_back(position.y);
+		z.push_back(position.z);
+	}
+	MortonOrder morton_order;
+	morton_order.build(x.data(), y.data(), z.data(), DROPLET_COUNT, EFFECTIVE_DISTANCE);
+	std::vector<uint32_t> order = morton_order.get_order();
+	std::vector<uint32_t> sorted_order = order;
+	std::sort(sorted_order.begin(), sorted_order.end());
+	bool is_permutation = sorted_order.size() == DROPLET_COUNT;
+	for (uint32_t i = 0; i < sorted_order.size() && is_permutation; ++i)
+	{
+		is_permutation = sorted_order[i] == i;
+	}
+	check(is_permutation && !morton_order.is_identity(), "morton/order_is_permutation");
+	// Sort a solver, then put everything back where it came from with the inverse of the order
+	CohesionSolver solver;
+	fill_solver(solver, cloud, COHESION_ACCUMULATION_MODE_GATHER, 0.0, 1);
+	solver.step(false);
+	std::vector<Vec3> forces(DROPLET_COUNT);
+	for (uint32_t i = 0; i < DROPLET_COUNT; ++i)
+	{
+		forces[i] = solver.get_force(i);
+	}
+	std::vector<uint32_t> solver_order = solver.sort_points_spatially();
+	solver.step(false);
+	std::vector<Vec3> restored_positions(DROPLET_COUNT), restored_forces(DROPLET_COUNT);
+	for (uint32_t i = 0; i < DROPLET_COUNT; ++i)
+	{
+		restored_positions[solver_order[i]] = solver.get_position(i);
+		restored_forces[solver_order[i]] = solver.get_force(i);
+	}
+	bool round_trips = solver_order == order;
+	float worst_force = 0.0f;
+	for (uint32_t i = 0; i < DROPLET_COUNT && round_trips; ++i)
+	{
+		round_trips = restored_positions[i] == cloud[i];
+		worst_force = std::max(worst_force, relative_difference(forces[i], restored_forces[i]));
+	}
+	check(round_trips && worst_force <= 1e-4f, "morton/solver_sort_round_trips", "force error " + format_error(worst_force));
+}
+
+
+
+// Main
+
+int main()
+{
+	std::printf("Kernel instruction set: %s\n\n", cohesion_kernel_get_isa_name(cohesion_kernel_get_isa()));
+	check_kernels();
+	check_pair_loops();
+	check_components();
+	check_morton_order();
+	std::printf("\n%s\n", g_failure_count == 0 ? "All checks passed" : (std::to_string(g_failure_count) + " check(s) failed").c_str());
+	return g_failure_count == 0 ? 0 : 1;
+}
@@ -0,0 +1,322 @@
+#include "cohesion_kernel.h"
+
+#include <cmath>
+
+// Only x86 gets vectorized kernels, other platforms (such as ARM macOS) use the scalar one
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define COHESION_KERNEL_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang need each function to opt in to the instruction sets it uses, while MSVC allows any
+// intrinsic anywhere. Either way, a function is only called once the CPU is known to support it.
+#if defined(__GNUC__) || defined(__clang__)
+#define COHESION_KERNEL_TARGET(isa) __attribute__((target(isa)))
+#else
+#define COHESION_KERNEL_TARGET(isa)
+#endif
+
+// Kernel Implementations
+
+namespace
+{
+	// The signature shared by every implementation of the kernel
+	typedef void (*KernelFunction)(const float*, const float*, const float*, size_t, const Vec3&, float, CohesionKernelPrecision, float*, Vec3&);
+
+	// Plain C++, used on every platform and for the leftover candidates of the vectorized kernels. There is no
+	// portable reciprocal square root estimate, so it is always exact whatever the precision.
+	void accumulate_scalar(const float* candidates_x, const float* candidates_y, const float* candidates_z, size_t candidate_count,
+		const Vec3& position, float radius_squared, CohesionKernelPrecision /*precision*/, float* distances_squared, Vec3& direction_sum)
+	{
+		for (size_t i = 0; i < candidate_count; ++i)
+		{
+			float diff_x = candidates_x[i] - position.x;
+			float diff_y = candidates_y[i] - position.y;
+			float diff_z = candidates_z[i] - position.z;
+			float distance_squared = diff_x * diff_x + diff_y * diff_y + diff_z * diff_z;
+			distances_squared[i] = distance_squared;
+			if (distance_squared < radius_squared && distance_squared > 0.0f)
+			{
+				float inverse_distance = 1.0f / std::sqrt(distance_squared);
+				direction_sum.x += diff_x * inverse_distance;
+				direction_sum.y += diff_y * inverse_distance;
+				direction_sum.z += diff_z * inverse_distance;
+			}
+		}
+	}
+
+#ifdef COHESION_KERNEL_X86
+
+	// 4 candidates at a time
+	COHESION_KERNEL_TARGET("sse2")
+	void accumulate_sse2(const float* candidates_x, const float* candidates_y, const float* candidates_z, size_t candidate_count,
+		const Vec3& position, float radius_squared, CohesionKernelPrecision precision, float* distances_squared, Vec3& direction_sum)
+	{
+		const __m128 position_x = _mm_set1_ps(position.x);
+		const __m128 position_y = _mm_set1_ps(position.y);
+		const __m128 position_z = _mm_set1_ps(position.z);
+		const __m128 radius_squared_4 = _mm_set1_ps(radius_squared);
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 half = _mm_set1_ps(0.5f);
+		const __m128 three_halves = _mm_set1_ps(1.5f);
+		const __m128 one = _mm_set1_ps(1.0f);
+		__m128 sum_x = zero, sum_y = zero, sum_z = zero;
+		size_t i = 0;
+		for (; i + 4 <= candidate_count; i += 4)
+		{
+			__m128 diff_x = _mm_sub_ps(_mm_loadu_ps(candidates_x + i), position_x);
+			__m128 diff_y = _mm_sub_ps(_mm_loadu_ps(candidates_y + i), position_y);
+			__m128 diff_z = _mm_sub_ps(_mm_loadu_ps(candidates_z + i), position_z);
+			__m128 distance_squared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(diff_x, diff_x), _mm_mul_ps(diff_y, diff_y)), _mm_mul_ps(diff_z, diff_z));
+			_mm_storeu_ps(distances_squared + i, distance_squared);
+			__m128 in_range = _mm_and_ps(_mm_cmplt_ps(distance_squared, radius_squared_4), _mm_cmpgt_ps(distance_squared, zero));
+			__m128 inverse_distance;
+			if (precision == COHESION_KERNEL_PRECISION_EXACT)
+			{
+				inverse_distance = _mm_div_ps(one, _mm_sqrt_ps(distance_squared));
+			}
+			else
+			{
+				inverse_distance = _mm_rsqrt_ps(distance_squared);
+				if (precision == COHESION_KERNEL_PRECISION_REFINED)
+				{
+					__m128 error = _mm_mul_ps(_mm_mul_ps(half, distance_squared), _mm_mul_ps(inverse_distance, inverse_distance));
+					inverse_distance = _mm_mul_ps(inverse_distance, _mm_sub_ps(three_halves, error));
+				}
+			}
+			// Masking also zeroes the infinities produced by candidates at a distance of zero
+			inverse_distance = _mm_and_ps(inverse_distance, in_range);
+			sum_x = _mm_add_ps(sum_x, _mm_mul_ps(diff_x, inverse_distance));
+			sum_y = _mm_add_ps(sum_y, _mm_mul_ps(diff_y, inverse_distance));
+			sum_z = _mm_add_ps(sum_z, _mm_mul_ps(diff_z, inverse_distance));
+		}
+		alignas(16) float lanes_x[4], lanes_y[4], lanes_z[4];
+		_mm_store_ps(lanes_x, sum_x);
+		_mm_store_ps(lanes_y, sum_y);
+		_mm_store_ps(lanes_z, sum_z);
+		direction_sum.x += lanes_x[0] + lanes_x[1] + lanes_x[2] + lanes_x[3];
+		direction_sum.y += lanes_y[0] + lanes_y[1] + lanes_y[2] + lanes_y[3];
+		direction_sum.z += lanes_z[0] + lanes_z[1] + lanes_z[2] + lanes_z[3];
+		accumulate_scalar(candidates_x + i, candidates_y + i, candidates_z + i, candidate_count - i,
+			position, radius_squared, precision, distances_squared + i, direction_sum);
+	}
+
+	// Adds up the lanes of an AVX register
+	COHESION_KERNEL_TARGET("avx2,fma")
+	float horizontal_sum_avx2(__m256 lanes)
+	{
+		__m128 sum = _mm_add_ps(_mm256_castps256_ps128(lanes), _mm256_extractf128_ps(lanes, 1));
+		sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+		sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+		return _mm_cvtss_f32(sum);
+	}
+
+	// 8 candidates at a time
+	COHESION_KERNEL_TARGET("avx2,fma")
+	void accumulate_avx2(const float* candidates_x, const float* candidates_y, const float* candidates_z, size_t candidate_count,
+		const Vec3& position, float radius_squared, CohesionKernelPrecision precision, float* distances_squared, Vec3& direction_sum)
+	{
+		const __m256 position_x = _mm256_set1_ps(position.x);
+		const __m256 position_y = _mm256_set1_ps(position.y);
+		const __m256 position_z = _mm256_set1_ps(position.z);
+		const __m256 radius_squared_8 = _mm256_set1_ps(radius_squared);
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 half = _mm256_set1_ps(0.5f);
+		const __m256 three_halves = _mm256_set1_ps(1.5f);
+		const __m256 one = _mm256_set1_ps(1.0f);
+		__m256 sum_x = zero, sum_y = zero, sum_z = zero;
+		size_t i = 0;
+		for (; i + 8 <= candidate_count; i += 8)
+		{
+			__m256 diff_x = _mm256_sub_ps(_mm256_loadu_ps(candidates_x + i), position_x);
+			__m256 diff_y = _mm256_sub_ps(_mm256_loadu_ps(candidates_y + i), position_y);
+			__m256 diff_z = _mm256_sub_ps(_mm256_loadu_ps(candidates_z + i), position_z);
+			__m256 distance_squared = _mm256_fmadd_ps(diff_z, diff_z, _mm256_fmadd_ps(diff_y, diff_y, _mm256_mul_ps(diff_x, diff_x)));
+			_mm256_storeu_ps(distances_squared + i, distance_squared);
+			__m256 in_range = _mm256_and_ps(_mm256_cmp_ps(distance_squared, radius_squared_8, _CMP_LT_OQ), _mm256_cmp_ps(distance_squared, zero, _CMP_GT_OQ));
+			__m256 inverse_distance;
+			if (precision == COHESION_KERNEL_PRECISION_EXACT)
+			{
+				inverse_distance = _mm256_div_ps(one, _mm256_sqrt_ps(distance_squared));
+			}
+			else
+			{
+				inverse_distance = _mm256_rsqrt_ps(distance_squared);
+				if (precision == COHESION_KERNEL_PRECISION_REFINED)
+				{
+					__m256 error = _mm256_mul_ps(_mm256_mul_ps(half, distance_squared), _mm256_mul_ps(inverse_distance, inverse_distance));
+					inverse_distance = _mm256_mul_ps(inverse_distance, _mm256_sub_ps(three_halves, error));
+				}
+			}
+			// Masking also zeroes the infinities produced by candidates at a distance of zero
+			inverse_distance = _mm256_and_ps(inverse_distance, in_range);
+			sum_x = _mm256_fmadd_ps(diff_x, inverse_distance, sum_x);
+			sum_y = _mm256_fmadd_ps(diff_y, inverse_distance, sum_y);
+			sum_z = _mm256_fmadd_ps(diff_z, inverse_distance, sum_z);
+		}
+		direction_sum.x += horizontal_sum_avx2(sum_x);
+		direction_sum.y += horizontal_sum_avx2(sum_y);
+		direction_sum.z += horizontal_sum_avx2(sum_z);
+		accumulate_scalar(candidates_x + i, candidates_y + i, candidates_z + i, candidate_count - i,
+			position, radius_squared, precision, distances_squared + i, direction_sum);
+	}
+
+	// 16 candidates at a time
+	COHESION_KERNEL_TARGET("avx512f")
+	void accumulate_avx512(const float* candidates_x, const float* candidates_y, const float* candidates_z, size_t candidate_count,
+		const Vec3& position, float radius_squared, CohesionKernelPrecision precision, float* distances_squared, Vec3& direction_sum)
+	{
+		const __m512 position_x = _mm512_set1_ps(position.x);
+		const __m512 position_y = _mm512_set1_ps(position.y);
+		const __m512 position_z = _mm512_set1_ps(position.z);
+		const __m512 radius_squared_16 = _mm512_set1_ps(radius_squared);
+		const __m512 zero = _mm512_setzero_ps();
+		const __m512 half = _mm512_set1_ps(0.5f);
+		const __m512 three_halves = _mm512_set1_ps(1.5f);
+		const __m512 one = _mm512_set1_ps(1.0f);
+		__m512 sum_x = zero, sum_y = zero, sum_z = zero;
+		size_t i = 0;
+		for (; i + 16 <= candidate_count; i += 16)
+		{
+			__m512 diff_x = _mm512_sub_ps(_mm512_loadu_ps(candidates_x + i), position_x);
+			__m512 diff_y = _mm512_sub_ps(_mm512_loadu_ps(candidates_y + i), position_y);
+			__m512 diff_z = _mm512_sub_ps(_mm512_loadu_ps(candidates_z + i), position_z);
+			__m512 distance_squared = _mm512_fmadd_ps(diff_z, diff_z, _mm512_fmadd_ps(diff_y, diff_y, _mm512_mul_ps(diff_x, diff_x)));
+			_mm512_storeu_ps(distances_squared + i, distance_squared);
+			__mmask16 in_range = _mm512_cmp_ps_mask(distance_squared, radius_squared_16, _CMP_LT_OQ) & _mm512_cmp_ps_mask(distance_squared, zero, _CMP_GT_OQ);
+			__m512 inverse_distance;
+			if (precision == COHESION_KERNEL_PRECISION_EXACT)
+			{
+				inverse_distance = _mm512_div_ps(one, _mm512_sqrt_ps(distance_squared));
+			}
+			else
+			{
+				inverse_distance = _mm512_rsqrt14_ps(distance_squared);
+				if (precision == COHESION_KERNEL_PRECISION_REFINED)
+				{
+					__m512 error = _mm512_mul_ps(_mm512_mul_ps(half, distance_squared), _mm512_mul_ps(inverse_distance, inverse_distance));
+					inverse_distance = _mm512_mul_ps(inverse_distance, _mm512_sub_ps(three_halves, error));
+				}
+			}
+			// Masking also zeroes the infinities produced by candidates at a distance of zero
+			inverse_distance = _mm512_maskz_mov_ps(in_range, inverse_distance);
+			sum_x = _mm512_fmadd_ps(diff_x, inverse_distance, sum_x);
+			sum_y = _mm512_fmadd_ps(diff_y, inverse_distance, sum_y);
+			sum_z = _mm512_fmadd_ps(diff_z, inverse_distance, sum_z);
+		}
+		direction_sum.x += _mm512_reduce_add_ps(sum_x);
+		direction_sum.y += _mm512_reduce_add_ps(sum_y);
+		direction_sum.z += _mm512_reduce_add_ps(sum_z);
+		accumulate_scalar(candidates_x + i, candidates_y + i, candidates_z + i, candidate_count - i,
+			position, radius_squared, precision, distances_squared + i, direction_sum);
+	}
+
+#endif
+
+	// Finds the fastest instruction set that both the CPU and the operating system support
+	CohesionKernelIsa detect_isa()
+	{
+#if defined(COHESION_KERNEL_X86) && defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+		int max_leaf = info[0];
+		__cpuid(info, 1);
+		bool has_sse2 = (info[3] & (1 << 26)) != 0;
+		bool has_fma = (info[2] & (1 << 12)) != 0;
+		bool has_osxsave = (info[2] & (1 << 27)) != 0;
+		bool has_avx2 = false;
+		bool has_avx512 = false;
+		if (max_leaf >= 7 && has_osxsave)
+		{
+			// The operating system has to save the wider registers for them to be usable
+			unsigned long long enabled_state = _xgetbv(0);
+			__cpuidex(info, 7, 0);
+			has_avx2 = has_fma && (info[1] & (1 << 5)) != 0 && (enabled_state & 0x6) == 0x6;
+			has_avx512 = (info[1] & (1 << 16)) != 0 && (enabled_state & 0xE6) == 0xE6;
+		}
+		if (has_avx512)
+			return COHESION_KERNEL_ISA_AVX512;
+		if (has_avx2)
+			return COHESION_KERNEL_ISA_AVX2;
+		if (has_sse2)
+			return COHESION_KERNEL_ISA_SSE2;
+#elif defined(COHESION_KERNEL_X86)
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx512f"))
+			return COHESION_KERNEL_ISA_AVX512;
+		if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+			return COHESION_KERNEL_ISA_AVX2;
+		if (__builtin_cpu_supports("sse2"))
+			return COHESION_KERNEL_ISA_SSE2;
+#endif
+		return COHESION_KERNEL_ISA_SCALAR;
+	}
+
+	// Gets the kernel implementation for an instruction set
+	KernelFunction get_kernel_function(CohesionKernelIsa isa)
+	{
+		switch (isa)
+		{
+#ifdef COHESION_KERNEL_X86
+			case COHESION_KERNEL_ISA_AVX512:
+				return accumulate_avx512;
+			case COHESION_KERNEL_ISA_AVX2:
+				return accumulate_avx2;
+			case COHESION_KERNEL_ISA_SSE2:
+				return accumulate_sse2;
+#endif
+			default:
+				return accumulate_scalar;
+		}
+	}
+
+	// The best instruction set available, along with the one currently in use
+	const CohesionKernelIsa s_supported_isa = detect_isa();
+	CohesionKernelIsa s_isa = s_supported_isa;
+	KernelFunction s_kernel_function = get_kernel_function(s_supported_isa);
+}
+
+// Kernel Entry Point
+
+void cohesion_kernel_accumulate(const float* candidates_x, const float* candidates_y, const float* candidates_z, size_t candidate_count,
+	const Vec3& position, float radius_squared, float magnitude, CohesionKernelPrecision precision,
+	float* distances_squared, Vec3& force)
+{
+	Vec3 direction_sum = Vec3::ZERO;
+	s_kernel_function(candidates_x, candidates_y, candidates_z, candidate_count,
+		position, radius_squared, precision, distances_squared, direction_sum);
+	force.add_scaled(direction_sum, magnitude);
+}
+
+// Getters and Setters for the Instruction Set
+
+CohesionKernelIsa cohesion_kernel_get_isa()
+{
+	return s_isa;
+}
+
+// Not thread safe, so it should only be called while no kernels are running
+CohesionKernelIsa cohesion_kernel_set_isa(CohesionKernelIsa isa)
+{
+	s_isa = isa < s_supported_isa ? isa : s_supported_isa;
+	s_kernel_function = get_kernel_function(s_isa);
+	return s_isa;
+}
+
+const char* cohesion_kernel_get_isa_name(CohesionKernelIsa isa)
+{
+	switch (isa)
+	{
+		case COHESION_KERNEL_ISA_AVX512:
+			return "AVX-512";
+		case COHESION_KERNEL_ISA_AVX2:
+			return "AVX2";
+		case COHESION_KERNEL_ISA_SSE2:
+			return "SSE2";
+		default:
+			return "Scalar";
+	}
+}
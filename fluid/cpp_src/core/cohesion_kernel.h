@@ -0,0 +1,42 @@
+#ifndef COHESION_KERNEL_H
+#define COHESION_KERNEL_H
+
+#include <cstddef>
+
+#include "vec3.h"
+
+// How accurately the kernel computes the inverse distance between droplets (the scalar kernel, which also
+// handles the candidates left over from each vectorized kernel, is always exact)
+enum CohesionKernelPrecision
+{
+	// A full square root and division
+	COHESION_KERNEL_PRECISION_EXACT,
+	// A hardware reciprocal square root estimate refined with one Newton-Raphson step (about 22 bits)
+	COHESION_KERNEL_PRECISION_REFINED,
+	// The raw hardware reciprocal square root estimate (about 12 bits, or 14 with AVX-512)
+	COHESION_KERNEL_PRECISION_FAST
+};
+
+// The instruction set that the kernel runs on, from slowest to fastest
+enum CohesionKernelIsa
+{
+	COHESION_KERNEL_ISA_SCALAR,
+	COHESION_KERNEL_ISA_SSE2,
+	COHESION_KERNEL_ISA_AVX2,
+	COHESION_KERNEL_ISA_AVX512
+};
+
+// Sums the unit vectors pointing from 'position' towards every candidate closer than the square root
+// of 'radius_squared' (candidates at exactly 'position' are skipped) and adds them, scaled by
+// 'magnitude', to 'force'. The squared distance to every candidate is written to 'distances_squared'.
+void cohesion_kernel_accumulate(const float* candidates_x, const float* candidates_y, const float* candidates_z, size_t candidate_count,
+	const Vec3& position, float radius_squared, float magnitude, CohesionKernelPrecision precision,
+	float* distances_squared, Vec3& force);
+
+// Getter and setter for the instruction set used by the kernel (picked at startup from what the CPU
+// supports, and clamped to that when set)
+CohesionKernelIsa cohesion_kernel_get_isa();
+CohesionKernelIsa cohesion_kernel_set_isa(CohesionKernelIsa isa);
+const char* cohesion_kernel_get_isa_name(CohesionKernelIsa isa);
+
+#endif
@@ -0,0 +1,1079 @@
+#include "cohesion_solver.h"
+
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+
+// Constructors and Destructors
+
+CohesionSolver::CohesionSolver() :
+	m_pos_x(), m_pos_y(), m_pos_z(),
+	m_force_x(), m_force_y(), m_force_z(),
+	m_point_domains(),
+	m_force_mutexes(),
+	m_grid(),
+	m_chunks(),
+	m_scheduler(),
+	m_neighbor_table(),
+	m_components(),
+	m_force_magnitude(25.0),
+	m_effective_distance(0.5),
+	m_effective_distance_squared(0.25),
+	m_domain_count(1),
+	m_domain_force_magnitudes(1, 25.0),
+	m_domain_effective_distances(1, 0.5),
+	m_domain_interactions(1, 1.0),
+	m_pair_force_magnitudes(1, 25.0),
+	m_pair_distances_squared(1, 0.25),
+	m_max_effective_distance(0.5),
+	m_accumulation_mode(COHESION_ACCUMULATION_MODE_GATHER),
+	m_kernel_precision(COHESION_KERNEL_PRECISION_REFINED),
+	m_count_pairs(false),
+	m_pairs_tested(0),
+	m_pairs_in_range(0),
+	m_step_timings(),
+	m_morton_order(),
+	m_verlet_skin(0.0),
+	m_verlet_list_valid(false),
+	m_verlet_x(), m_verlet_y(), m_verlet_z(),
+	m_verlet_starts(),
+	m_verlet_candidates(),
+	m_verlet_chunk_candidates(),
+	m_verlet_rebuild_count(0),
+	m_verlet_step_count(0),
+	m_dormant_clusters(),
+	m_dormant_count(0),
+	m_chunk_disturbed_clusters(),
+	m_disturbed_clusters()
+{}
+
+CohesionSolver::~CohesionSolver()
+{
+	// A step running in the background uses the members destroyed before the scheduler, so finish it first
+	wait_for_step();
+}
+
+// Settings
+
+float CohesionSolver::get_force_magnitude() const
+{
+	return m_force_magnitude;
+}
+
+// The force magnitude of domain 0 (the only domain, unless there are more)
+void CohesionSolver::set_force_magnitude(float force_magnitude)
+{
+	set_domain_force_magnitude(0, force_magnitude);
+}
+
+float CohesionSolver::get_effective_distance() const
+{
+	return m_effective_distance;
+}
+
+// The effective distance of domain 0 (negative distances are treated as zero, which turns the force off)
+void CohesionSolver::set_effective_distance(float effective_distance)
+{
+	set_domain_effective_distance(0, effective_distance);
+}
+
+CohesionAccumulationMode CohesionSolver::get_accumulation_mode() const
+{
+	return m_accumulation_mode;
+}
+
+void CohesionSolver::set_accumulation_mode(CohesionAccumulationMode accumulation_mode)
+{
+	m_accumulation_mode = accumulation_mode;
+}
+
+CohesionKernelPrecision CohesionSolver::get_kernel_precision() const
+{
+	return m_kernel_precision;
+}
+
+void CohesionSolver::set_kernel_precision(CohesionKernelPrecision kernel_precision)
+{
+	m_kernel_precision = kernel_precision;
+}
+
+// Whether the pair loop counts the pairs it tests and finds in range (off by default, since it costs a little)
+bool CohesionSolver::get_count_pairs() const
+{
+	return m_count_pairs;
+}
+
+void CohesionSolver::set_count_pairs(bool count_pairs)
+{
+	m_count_pairs = count_pairs;
+}
+
+// How much further than the effective distance the cached nearby pairs reach (0 turns the cache off, and
+// negative skins are treated as zero). Setting it restarts the rebuild counters.
+float CohesionSolver::get_verlet_skin() const
+{
+	return m_verlet_skin;
+}
+
+void CohesionSolver::set_verlet_skin(float verlet_skin)
+{
+	m_verlet_skin = verlet_skin < 0 ? 0 : verlet_skin;
+	m_verlet_list_valid = false;
+	m_verlet_rebuild_count = 0;
+	m_verlet_step_count = 0;
+}
+
+// The number of threads the pair loops run on, including the calling thread (0 means one per CPU core)
+size_t CohesionSolver::get_thread_count() const
+{
+	return m_scheduler.get_thread_count();
+}
+
+void CohesionSolver::set_thread_count(size_t thread_count)
+{
+	// The threads are restarted, so a step running in the background has to finish first
+	wait_for_step();
+	m_scheduler.set_thread_count(thread_count);
+}
+
+// Domains
+
+uint32_t CohesionSolver::get_domain_count() const
+{
+	return m_domain_count;
+}
+
+// Sets the number of domains (from 1 up to MAX_DOMAIN_COUNT). New domains start with the settings of domain 0
+// and no interaction with the others, and points in domains that no longer exist move to domain 0.
+void CohesionSolver::set_domain_count(uint32_t domain_count)
+{
+	domain_count = std::max<uint32_t>(1, std::min(domain_count, MAX_DOMAIN_COUNT));
+	std::vector<float> domain_interactions(domain_count * domain_count, 0.0f);
+	for (uint32_t domain_a = 0; domain_a < domain_count; ++domain_a)
+	{
+		for (uint32_t domain_b = 0; domain_b < domain_count; ++domain_b)
+		{
+			if (domain_a < m_domain_count && domain_b < m_domain_count)
+				domain_interactions[domain_a * domain_count + domain_b] = m_domain_interactions[domain_a * m_domain_count + domain_b];
+			else if (domain_a == domain_b)
+				domain_interactions[domain_a * domain_count + domain_b] = 1.0f;
+		}
+	}
+	m_domain_interactions.swap(domain_interactions);
+	m_domain_force_magnitudes.resize(domain_count, m_force_magnitude);
+	m_domain_effective_distances.resize(domain_count, m_effective_distance);
+	m_domain_count = domain_count;
+	for (uint32_t& point_domain : m_point_domains)
+	{
+		if (point_domain >= m_domain_count)
+			point_domain = 0;
+	}
+	update_domain_pairs();
+}
+
+float CohesionSolver::get_domain_force_magnitude(uint32_t domain) const
+{
+	return m_domain_force_magnitudes[domain];
+}
+
+void CohesionSolver::set_domain_force_magnitude(uint32_t domain, float force_magnitude)
+{
+	m_domain_force_magnitudes[domain] = force_magnitude;
+	update_domain_pairs();
+}
+
+float CohesionSolver::get_domain_effective_distance(uint32_t domain) const
+{
+	return m_domain_effective_distances[domain];
+}
+
+// Negative distances are treated as zero (which turns the force off)
+void CohesionSolver::set_domain_effective_distance(uint32_t domain, float effective_distance)
+{
+	m_domain_effective_distances[domain] = effective_distance < 0 ? 0 : effective_distance;
+	update_domain_pairs();
+}
+
+// How strongly two domains attract each other, as a fraction of the average of their force magnitudes (pairs
+// within a domain default to 1, and pairs across domains to 0, which also keeps them out of the neighbor table)
+float CohesionSolver::get_domain_interaction(uint32_t domain_a, uint32_t domain_b) const
+{
+	return m_domain_interactions[domain_a * m_domain_count + domain_b];
+}
+
+// Sets the interaction both ways round, so that the forces stay equal and opposite
+void CohesionSolver::set_domain_interaction(uint32_t domain_a, uint32_t domain_b, float interaction)
+{
+	m_domain_interactions[domain_a * m_domain_count + domain_b] = interaction;
+	m_domain_interactions[domain_b * m_domain_count + domain_a] = interaction;
+	update_domain_pairs();
+}
+
+// Adding and Removing Points
+
+// Makes room for a number of points, so that adding them does not reallocate
+void CohesionSolver::reserve(size_t capacity)
+{
+	m_pos_x.reserve(capacity);
+	m_pos_y.reserve(capacity);
+	m_pos_z.reserve(capacity);
+	m_force_x.reserve(capacity);
+	m_force_y.reserve(capacity);
+	m_force_z.reserve(capacity);
+	m_point_domains.reserve(capacity);
+	m_dormant_clusters.reserve(capacity);
+}
+
+// Appends a point to the end of the arrays and returns its index
+uint32_t CohesionSolver::add_point(const Vec3& position, uint32_t domain)
+{
+	m_pos_x.push_back(position.x);
+	m_pos_y.push_back(position.y);
+	m_pos_z.push_back(position.z);
+	m_force_x.push_back(0.0);
+	m_force_y.push_back(0.0);
+	m_force_z.push_back(0.0);
+	m_point_domains.push_back(domain < m_domain_count ? domain : 0);
+	m_dormant_clusters.push_back(NO_DORMANT_CLUSTER);
+	m_verlet_list_valid = false;
+	return m_pos_x.size() - 1;
+}
+
+// Removes a point by moving the last point into its place (so only the last point's index changes). The
+// neighbor table and components refer to points by index, so they are out of date afterwards.
+void CohesionSolver::swap_remove_point(uint32_t index)
+{
+	size_t last = m_pos_x.size() - 1;
+	m_pos_x[index] = m_pos_x[last];
+	m_pos_y[index] = m_pos_y[last];
+	m_pos_z[index] = m_pos_z[last];
+	m_force_x[index] = m_force_x[last];
+	m_force_y[index] = m_force_y[last];
+	m_force_z[index] = m_force_z[last];
+	m_point_domains[index] = m_point_domains[last];
+	if (m_dormant_clusters[index] != NO_DORMANT_CLUSTER)
+		--m_dormant_count;
+	m_dormant_clusters[index] = m_dormant_clusters[last];
+	m_pos_x.pop_back();
+	m_pos_y.pop_back();
+	m_pos_z.pop_back();
+	m_force_x.pop_back();
+	m_force_y.pop_back();
+	m_force_z.pop_back();
+	m_point_domains.pop_back();
+	m_dormant_clusters.pop_back();
+	m_verlet_list_valid = false;
+}
+
+size_t CohesionSolver::get_point_count() const
+{
+	return m_pos_x.size();
+}
+
+// Reorders the points along a Morton curve through cells as wide as the largest effective distance, so that
+// points near each other in space are near each other in memory as well, and returns the new order (the old
+// index of the point now at each index) so the owner can reorder its own arrays to match. Anything that
+// refers to points by index (the neighbor table, components, and cached Verlet pairs) is out of date afterwards.
+const std::vector<uint32_t>& CohesionSolver::sort_points_spatially()
+{
+	m_morton_order.build(m_pos_x.data(), m_pos_y.data(), m_pos_z.data(), get_point_count(), m_max_effective_distance);
+	if (m_morton_order.is_identity())
+		return m_morton_order.get_order();
+	const std::vector<uint32_t>& order = m_morton_order.get_order();
+	permute(m_pos_x, order);
+	permute(m_pos_y, order);
+	permute(m_pos_z, order);
+	permute(m_force_x, order);
+	permute(m_force_y, order);
+	permute(m_force_z, order);
+	permute(m_point_domains, order);
+	permute(m_dormant_clusters, order);
+	m_neighbor_table.clear(get_point_count());
+	m_verlet_list_valid = false;
+	return order;
+}
+
+// Point Data
+
+Vec3 CohesionSolver::get_position(uint32_t index) const
+{
+	return Vec3(m_pos_x[index], m_pos_y[index], m_pos_z[index]);
+}
+
+void CohesionSolver::set_position(uint32_t index, const Vec3& position)
+{
+	m_pos_x[index] = position.x;
+	m_pos_y[index] = position.y;
+	m_pos_z[index] = position.z;
+}
+
+const float* CohesionSolver::get_x() const
+{
+	return m_pos_x.data();
+}
+
+const float* CohesionSolver::get_y() const
+{
+	return m_pos_y.data();
+}
+
+const float* CohesionSolver::get_z() const
+{
+	return m_pos_z.data();
+}
+
+// Gets the force summed up for a point by the last call to accumulate_forces()
+Vec3 CohesionSolver::get_force(uint32_t index) const
+{
+	return Vec3(m_force_x[index], m_force_y[index], m_force_z[index]);
+}
+
+uint32_t CohesionSolver::get_domain(uint32_t index) const
+{
+	return m_point_domains[index];
+}
+
+// Moves a point to another domain (domains that do not exist are treated as domain 0)
+void CohesionSolver::set_domain(uint32_t index, uint32_t domain)
+{
+	m_point_domains[index] = domain < m_domain_count ? domain : 0;
+}
+
+// Dormant Points
+
+uint32_t CohesionSolver::get_dormant_cluster(uint32_t index) const
+{
+	return m_dormant_clusters[index];
+}
+
+// Puts a point to sleep as part of a cluster (whose number is up to the caller), or wakes it up if the
+// cluster is NO_DORMANT_CLUSTER. Dormant points get no force, and the neighbor table built by
+// accumulate_forces() leaves out the pairs between them.
+void CohesionSolver::set_dormant_cluster(uint32_t index, uint32_t cluster)
+{
+	m_dormant_count -= m_dormant_clusters[index] != NO_DORMANT_CLUSTER;
+	m_dormant_count += cluster != NO_DORMANT_CLUSTER;
+	m_dormant_clusters[index] = cluster;
+}
+
+bool CohesionSolver::is_dormant(uint32_t index) const
+{
+	return m_dormant_clusters[index] != NO_DORMANT_CLUSTER;
+}
+
+size_t CohesionSolver::get_dormant_count() const
+{
+	return m_dormant_count;
+}
+
+// Gets the clusters that had an awake point within the effective distance of one of their points during
+// the last call to accumulate_forces() (sorted, without repeats)
+const std::vector<uint32_t>& CohesionSolver::get_disturbed_clusters() const
+{
+	return m_disturbed_clusters;
+}
+
+// Stepping the Simulation
+
+// Sorts the current positions into the grid and splits the points into chunks for the pair loop. With a
+// Verlet skin, this only happens when the cached nearby pairs are out of date, and rebuilds them as well.
+void CohesionSolver::update_grid()
+{
+	m_chunks.clear();
+	for (uint32_t chunk_start = 0; chunk_start < get_point_count(); chunk_start += POINTS_PER_CHUNK)
+	{
+		m_chunks.push_back(chunk_start);
+	}
+	// There are no pairs to find if the distance is zero (and the grid needs cells with some size)
+	if (m_max_effective_distance <= 0.0)
+		return;
+	if (m_verlet_skin > 0.0)
+	{
+		++m_verlet_step_count;
+		if (!verlet_list_needs_rebuild())
+			return;
+	}
+	// Cells as wide as the skin's reach still find every pair within the effective distance
+	m_grid.reset(m_max_effective_distance + m_verlet_skin, get_point_count());
+	for (uint32_t i = 0; i < get_point_count(); ++i)
+	{
+		m_grid.set_point(i, get_position(i));
+	}
+	m_grid.build();
+	if (m_verlet_skin > 0.0)
+		build_verlet_list();
+}
+
+// Sums up the cohesive force on every point from the grid built by update_grid(), optionally collecting
+// the nearby pairs for build_neighbor_table(). The pairs between dormant points are never visited, so
+// while there are any the pairs are not collected at all (collect_neighbors() finds every pair).
+void CohesionSolver::accumulate_forces(bool record_neighbors)
+{
+	record_neighbors = record_neighbors && m_dormant_count == 0;
+	m_pairs_tested.store(0, std::memory_order_relaxed);
+	m_pairs_in_range.store(0, std::memory_order_relaxed);
+	if (record_neighbors)
+	{
+		m_neighbor_table.reset(get_point_count(), m_chunks.size());
+	}
+	m_disturbed_clusters.clear();
+	m_chunk_disturbed_clusters.resize(m_chunks.size());
+	for (std::vector<uint32_t>& chunk_disturbed_clusters : m_chunk_disturbed_clusters)
+	{
+		chunk_disturbed_clusters.clear();
+	}
+	// There are no pairs if the distance is zero
+	if (m_max_effective_distance <= 0.0)
+	{
+		std::fill(m_force_x.begin(), m_force_x.end(), 0.0f);
+		std::fill(m_force_y.begin(), m_force_y.end(), 0.0f);
+		std::fill(m_force_z.begin(), m_force_z.end(), 0.0f);
+		return;
+	}
+	if (m_verlet_skin > 0.0)
+		accumulate_forces_verlet(record_neighbors);
+	else if (m_domain_count > 1)
+		accumulate_forces_domains(record_neighbors);
+	else if (m_accumulation_mode == COHESION_ACCUMULATION_MODE_LOCKED)
+		accumulate_forces_locked(record_neighbors);
+	else
+		accumulate_forces_gather(record_neighbors);
+	// Merge the clusters each chunk found awake points near
+	if (m_dormant_count > 0)
+	{
+		for (const std::vector<uint32_t>& chunk_disturbed_clusters : m_chunk_disturbed_clusters)
+		{
+			m_disturbed_clusters.insert(m_disturbed_clusters.end(), chunk_disturbed_clusters.begin(), chunk_disturbed_clusters.end());
+		}
+		std::sort(m_disturbed_clusters.begin(), m_disturbed_clusters.end());
+		m_disturbed_clusters.erase(std::unique(m_disturbed_clusters.begin(), m_disturbed_clusters.end()), m_disturbed_clusters.end());
+	}
+}
+
+// Collects the nearby pairs for build_neighbor_table() from the grid built by update_grid(), without
+// computing any forces
+void CohesionSolver::collect_neighbors()
+{
+	m_neighbor_table.reset(get_point_count(), m_chunks.size());
+	if (m_max_effective_distance <= 0.0)
+		return;
+	// The grid is not kept up to date with a Verlet skin, but the cached pairs are
+	if (m_verlet_skin > 0.0)
+	{
+		collect_neighbors_verlet();
+		return;
+	}
+	const uint32_t* sorted_points = m_grid.get_sorted_points();
+	const float* sorted_x = m_grid.get_sorted_x();
+	const float* sorted_y = m_grid.get_sorted_y();
+	const float* sorted_z = m_grid.get_sorted_z();
+	// Outer loop over chunks of points (each chunk collects its own nearby pairs)
+	m_scheduler.parallel_for(m_chunks.size(), [this, sorted_points, sorted_x, sorted_y, sorted_z] (size_t chunk)
+	{
+		uint32_t chunk_start = m_chunks[chunk];
+		uint32_t chunk_end = std::min<uint32_t>(chunk_start + POINTS_PER_CHUNK, get_point_count());
+		thread_local std::vector<float> distances_squared;
+		for (uint32_t point_a = chunk_start; point_a < chunk_end; ++point_a)
+		{
+			Vec3 point_a_position = get_position(point_a);
+			uint32_t buckets[SpatialHashGrid::MAX_NEIGHBOR_BUCKETS];
+			size_t bucket_count = m_grid.find_neighbor_buckets(point_a_position, buckets);
+			// How close each domain has to be to this point to count as nearby
+			const float* pair_distances_squared = &m_pair_distances_squared[m_point_domains[point_a] * m_domain_count];
+			// The force is thrown away, only the distances are needed
+			Vec3 unused_force = Vec3::ZERO;
+			for (size_t i = 0; i < bucket_count; ++i)
+			{
+				uint32_t bucket_start = m_grid.get_bucket_start(buckets[i]);
+				uint32_t bucket_size = m_grid.get_bucket_end(buckets[i]) - bucket_start;
+				distances_squared.resize(bucket_size);
+				cohesion_kernel_accumulate(sorted_x + bucket_start, sorted_y + bucket_start, sorted_z + bucket_start, bucket_size,
+					point_a_position, 0.0, 0.0, COHESION_KERNEL_PRECISION_FAST,
+					distances_squared.data(), unused_force);
+				for (uint32_t j = 0; j < bucket_size; ++j)
+				{
+					uint32_t point_b = sorted_points[bucket_start + j];
+					if (point_b > point_a && distances_squared[j] < pair_distances_squared[m_point_domains[point_b]])
+					{
+						m_neighbor_table.add_edge(chunk, point_a, point_b, distances_squared[j]);
+					}
+				}
+			}
+		}
+	});
+}
+
+// Turns the pairs collected by accumulate_forces() or collect_neighbors() into the neighbor table
+void CohesionSolver::build_neighbor_table()
+{
+	m_neighbor_table.build();
+}
+
+// Empties the neighbor table (for when the points it refers to have changed)
+void CohesionSolver::clear_neighbor_table()
+{
+	m_neighbor_table.clear(get_point_count());
+}
+
+// Groups the points that are connected through the neighbor table
+void CohesionSolver::build_components()
+{
+	m_components.build(get_point_count(), m_neighbor_table.get_edges());
+}
+
+// Finds the center of each group found by build_components()
+void CohesionSolver::compute_component_centers(std::vector<Vec3>& centers) const
+{
+	m_components.compute_centers(m_pos_x.data(), m_pos_y.data(), m_pos_z.data(), centers);
+}
+
+// Stepping in the Background
+
+// Runs a whole step from the current positions (update_grid(), accumulate_forces(), then, if recording
+// neighbors, build_neighbor_table(), and if grouping components as well, build_components()), timing each part.
+// Like accumulate_forces(), it does not record neighbors while any point is dormant.
+void CohesionSolver::step(bool record_neighbors, bool group_components)
+{
+	record_neighbors = record_neighbors && m_dormant_count == 0;
+	typedef std::chrono::steady_clock Clock;
+	Clock::time_point start = Clock::now();
+	update_grid();
+	Clock::time_point grid_end = Clock::now();
+	accumulate_forces(record_neighbors);
+	Clock::time_point pair_loop_end = Clock::now();
+	if (record_neighbors)
+		build_neighbor_table();
+	Clock::time_point neighbor_build_end = Clock::now();
+	if (record_neighbors && group_components)
+		build_components();
+	Clock::time_point components_end = Clock::now();
+	m_step_timings.grid_usec = std::chrono::duration<double, std::micro>(grid_end - start).count();
+	m_step_timings.pair_loop_usec = std::chrono::duration<double, std::micro>(pair_loop_end - grid_end).count();
+	m_step_timings.neighbor_build_usec = std::chrono::duration<double, std::micro>(neighbor_build_end - pair_loop_end).count();
+	m_step_timings.components_usec = std::chrono::duration<double, std::micro>(components_end - neighbor_build_end).count();
+}
+
+// Starts step() on the background thread and returns straight away. Nothing else about the solver (not
+// even the positions or the settings) should be touched until wait_for_step() returns.
+void CohesionSolver::begin_step(bool record_neighbors, bool group_components)
+{
+	m_scheduler.run_in_background([this, record_neighbors, group_components] ()
+	{
+		step(record_neighbors, group_components);
+	});
+}
+
+// Blocks until the step started by begin_step() (if any) has finished
+void CohesionSolver::wait_for_step()
+{
+	m_scheduler.wait_for_background();
+}
+
+bool CohesionSolver::is_step_running() const
+{
+	return m_scheduler.is_background_busy();
+}
+
+const CohesionSolver::StepTimings& CohesionSolver::get_step_timings() const
+{
+	return m_step_timings;
+}
+
+// Querying the Results
+
+const NeighborTable& CohesionSolver::get_neighbor_table() const
+{
+	return m_neighbor_table;
+}
+
+const ConnectedComponents& CohesionSolver::get_components() const
+{
+	return m_components;
+}
+
+// Gets how many pairs the last call to accumulate_forces() tested and found in range (each pair counted once)
+uint64_t CohesionSolver::get_pairs_tested() const
+{
+	return m_pairs_tested.load(std::memory_order_relaxed);
+}
+
+uint64_t CohesionSolver::get_pairs_in_range() const
+{
+	return m_pairs_in_range.load(std::memory_order_relaxed);
+}
+
+// Gets how many times the cached nearby pairs have been rebuilt, out of how many calls to update_grid(), since
+// the Verlet skin was last set
+uint64_t CohesionSolver::get_verlet_rebuild_count() const
+{
+	return m_verlet_rebuild_count;
+}
+
+uint64_t CohesionSolver::get_verlet_step_count() const
+{
+	return m_verlet_step_count;
+}
+
+// Gets the number of cached nearby pairs (each pair counted from both sides)
+size_t CohesionSolver::get_verlet_candidate_count() const
+{
+	return m_verlet_candidates.size();
+}
+
+// Helper Functions
+
+// Moves every element of an array to where an order says it belongs (the element at each index of the order)
+template <typename T>
+void CohesionSolver::permute(std::vector<T>& values, const std::vector<uint32_t>& order)
+{
+	std::vector<T> permuted(values.size());
+	for (size_t i = 0; i < order.size(); ++i)
+	{
+		permuted[i] = values[order[i]];
+	}
+	values.swap(permuted);
+}
+
+// Sums up the cohesive forces, visiting each pair once and locking both points to update them
+void CohesionSolver::accumulate_forces_locked(bool record_neighbors)
+{
+	// Both points of a pair are added to, so start from zero
+	std::fill(m_force_x.begin(), m_force_x.end(), 0.0f);
+	std::fill(m_force_y.begin(), m_force_y.end(), 0.0f);
+	std::fill(m_force_z.begin(), m_force_z.end(), 0.0f);
+	// The one domain's force magnitude, scaled by how much it interacts with itself (as in every other mode)
+	float force_magnitude = m_pair_force_magnitudes[0];
+	// Outer loop over chunks of points (each chunk collects its own nearby pairs)
+	m_scheduler.parallel_for(m_chunks.size(), [this, record_neighbors, force_magnitude] (size_t chunk)
+	{
+		uint32_t chunk_start = m_chunks[chunk];
+		uint32_t chunk_end = std::min<uint32_t>(chunk_start + POINTS_PER_CHUNK, get_point_count());
+		// Count pairs locally, then add them to the shared counters once per chunk
+		uint64_t pairs_tested = 0;
+		uint64_t pairs_in_range = 0;
+		// Loop to get first point
+		for (uint32_t point_a = chunk_start; point_a < chunk_end; ++point_a)
+		{
+			// Pairs with a dormant point are handled from the side of the awake one
+			if (m_dormant_count > 0 && is_dormant(point_a))
+				continue;
+			// Get the position of the first point
+			Vec3 point_a_position = get_position(point_a);
+			std::mutex& point_a_mutex = m_force_mutexes[point_a % FORCE_MUTEX_COUNT];
+			// Only points in the surrounding grid cells can be close enough
+			uint32_t buckets[SpatialHashGrid::MAX_NEIGHBOR_BUCKETS];
+			size_t bucket_count = m_grid.find_neighbor_buckets(point_a_position, buckets);
+			// Inner loop to get second point
+			const uint32_t* sorted_points = m_grid.get_sorted_points();
+			for (size_t i = 0; i < bucket_count; ++i)
+			{
+				uint32_t bucket_end = m_grid.get_bucket_end(buckets[i]);
+				for (uint32_t j = m_grid.get_bucket_start(buckets[i]); j < bucket_end; ++j)
+				{
+					// Visit each pair only once (from the lower index, unless the other point is dormant)
+					uint32_t point_b = sorted_points[j];
+					bool point_b_dormant = m_dormant_count > 0 && is_dormant(point_b);
+					if (point_b == point_a || (point_b < point_a && !point_b_dormant))
+						continue;
+					// Test if the points are close enough
+					Vec3 offset;
+					float distance_squared = point_a_position.distance_squared_and_diff(get_position(point_b), offset);
+					++pairs_tested;
+					if (distance_squared < m_effective_distance_squared)
+					{
+						++pairs_in_range;
+						// Apply cohesive forces (reusing the offset rather than subtracting again to normalize it)
+						Vec3 force = (force_magnitude / std::sqrt(distance_squared)) * offset;
+						point_a_mutex.lock();
+						m_force_x[point_a] -= force.x;
+						m_force_y[point_a] -= force.y;
+						m_force_z[point_a] -= force.z;
+						point_a_mutex.unlock();
+						// Dormant points keep still, but note that something has come near them
+						if (point_b_dormant)
+						{
+							m_chunk_disturbed_clusters[chunk].push_back(m_dormant_clusters[point_b]);
+							continue;
+						}
+						std::mutex& point_b_mutex = m_force_mutexes[point_b % FORCE_MUTEX_COUNT];
+						point_b_mutex.lock();
+						m_force_x[point_b] += force.x;
+						m_force_y[point_b] += force.y;
+						m_force_z[point_b] += force.z;
+						point_b_mutex.unlock();
+						// Record that the points are near each other
+						if (record_neighbors)
+							m_neighbor_table.add_edge(chunk, point_a, point_b, distance_squared);
+					}
+				}
+			}
+		}
+		if (m_count_pairs)
+		{
+			m_pairs_tested.fetch_add(pairs_tested, std::memory_order_relaxed);
+			m_pairs_in_range.fetch_add(pairs_in_range, std::memory_order_relaxed);
+		}
+	});
+}
+
+// Sums up the cohesive forces, visiting each pair from both sides so that no locking is needed
+void CohesionSolver::accumulate_forces_gather(bool record_neighbors)
+{
+	// The one domain's force magnitude, scaled by how much it interacts with itself (as in every other mode)
+	float force_magnitude = m_pair_force_magnitudes[0];
+	// Outer loop over chunks of points (each chunk collects its own nearby pairs)
+	m_scheduler.parallel_for(m_chunks.size(), [this, record_neighbors, force_magnitude] (size_t chunk)
+	{
+		uint32_t chunk_start = m_chunks[chunk];
+		uint32_t chunk_end = std::min<uint32_t>(chunk_start + POINTS_PER_CHUNK, get_point_count());
+		// Scratch space for the kernel to report distances in, and for the points around the current cell (kept per
+		// thread so they are only allocated once, but gathered again since the grid may have changed)
+		thread_local std::vector<float> distances_squared;
+		thread_local SpatialHashGrid::NeighborCandidates candidates;
+		candidates.is_valid = false;
+		// Count pairs locally, then add them to the shared counters once per chunk
+		uint64_t pairs_tested = 0;
+		uint64_t pairs_in_range = 0;
+		// Loop to get the point whose force is being summed
+		for (uint32_t point_a = chunk_start; point_a < chunk_end; ++point_a)
+		{
+			// Dormant points get no force
+			if (m_dormant_count > 0 && is_dormant(point_a))
+			{
+				m_force_x[point_a] = 0.0f;
+				m_force_y[point_a] = 0.0f;
+				m_force_z[point_a] = 0.0f;
+				continue;
+			}
+			// Get the position of the first point
+			Vec3 point_a_position = get_position(point_a);
+			// Only points in the surrounding grid cells can be close enough, and they are copied into one run so that
+			// the kernel's wide loops get enough of them (the copy is reused by the next point if it is in the same cell)
+			m_grid.gather_neighbor_candidates(point_a_position, candidates);
+			uint32_t candidate_count = candidates.size();
+			const uint32_t* candidate_points = candidates.points.data();
+			distances_squared.resize(candidate_count);
+			// Apply the cohesive forces to the first point only (the others get their share on their own turns), summing
+			// into a local so that other threads never see a partial force
+			Vec3 force = Vec3::ZERO;
+			cohesion_kernel_accumulate(candidates.x.data(), candidates.y.data(), candidates.z.data(), candidate_count,
+				point_a_position, m_effective_distance_squared, force_magnitude, m_kernel_precision,
+				distances_squared.data(), force);
+			if (m_dormant_count > 0)
+				record_disturbed_clusters(chunk, candidate_points, distances_squared.data(), candidate_count);
+			// Record the points that were close enough (each pair is seen from both sides, so keep just one)
+			for (uint32_t j = 0; record_neighbors && j < candidate_count; ++j)
+			{
+				uint32_t point_b = candidate_points[j];
+				if (distances_squared[j] < m_effective_distance_squared && point_b > point_a)
+				{
+					m_neighbor_table.add_edge(chunk, point_a, point_b, distances_squared[j]);
+				}
+			}
+			// Count the pairs (only from the side of the lower index, to match the locked mode)
+			if (m_count_pairs)
+			{
+				for (uint32_t j = 0; j < candidate_count; ++j)
+				{
+					bool is_lower_side = candidate_points[j] > point_a;
+					pairs_tested += is_lower_side;
+					pairs_in_range += is_lower_side && distances_squared[j] < m_effective_distance_squared;
+				}
+			}
+			m_force_x[point_a] = force.x;
+			m_force_y[point_a] = force.y;
+			m_force_z[point_a] = force.z;
+		}
+		if (m_count_pairs)
+		{
+			m_pairs_tested.fetch_add(pairs_tested, std::memory_order_relaxed);
+			m_pairs_in_range.fetch_add(pairs_in_range, std::memory_order_relaxed);
+		}
+	});
+}
+
+// Sums up the cohesive forces between points in different domains, visiting each pair from both sides like the
+// gather mode, but with a plain loop that looks up the force magnitude and effective distance of each pair
+void CohesionSolver::accumulate_forces_domains(bool record_neighbors)
+{
+	const uint32_t* sorted_points = m_grid.get_sorted_points();
+	const float* sorted_x = m_grid.get_sorted_x();
+	const float* sorted_y = m_grid.get_sorted_y();
+	const float* sorted_z = m_grid.get_sorted_z();
+	m_scheduler.parallel_for(m_chunks.size(), [this, record_neighbors, sorted_points, sorted_x, sorted_y, sorted_z] (size_t chunk)
+	{
+		uint32_t chunk_start = m_chunks[chunk];
+		uint32_t chunk_end = std::min<uint32_t>(chunk_start + POINTS_PER_CHUNK, get_point_count());
+		// Count pairs locally, then add them to the shared counters once per chunk
+		uint64_t pairs_tested = 0;
+		uint64_t pairs_in_range = 0;
+		for (uint32_t point_a = chunk_start; point_a < chunk_end; ++point_a)
+		{
+			// Dormant points get no force
+			if (m_dormant_count > 0 && is_dormant(point_a))
+			{
+				m_force_x[point_a] = 0.0f;
+				m_force_y[point_a] = 0.0f;
+				m_force_z[point_a] = 0.0f;
+				continue;
+			}
+			Vec3 point_a_position = get_position(point_a);
+			Vec3 force = Vec3::ZERO;
+			// The settings for pairs between this point's domain and each domain
+			const float* pair_force_magnitudes = &m_pair_force_magnitudes[m_point_domains[point_a] * m_domain_count];
+			const float* pair_distances_squared = &m_pair_distances_squared[m_point_domains[point_a] * m_domain_count];
+			uint32_t buckets[SpatialHashGrid::MAX_NEIGHBOR_BUCKETS];
+			size_t bucket_count = m_grid.find_neighbor_buckets(point_a_position, buckets);
+			for (size_t i = 0; i < bucket_count; ++i)
+			{
+				uint32_t bucket_end = m_grid.get_bucket_end(buckets[i]);
+				for (uint32_t j = m_grid.get_bucket_start(buckets[i]); j < bucket_end; ++j)
+				{
+					uint32_t point_b = sorted_points[j];
+					Vec3 offset = Vec3(sorted_x[j], sorted_y[j], sorted_z[j]) - point_a_position;
+					float distance_squared = offset.length_squared();
+					pairs_tested += point_b > point_a;
+					// Points at exactly the same position (including this point) have no direction to pull in
+					uint32_t domain_b = m_point_domains[point_b];
+					if (distance_squared < pair_distances_squared[domain_b] && distance_squared > 0.0f)
+					{
+						force.add_scaled(offset, pair_force_magnitudes[domain_b] / std::sqrt(distance_squared));
+						if (m_dormant_count > 0 && is_dormant(point_b))
+							m_chunk_disturbed_clusters[chunk].push_back(m_dormant_clusters[point_b]);
+						// Count and record each pair once, from the side of the lower index
+						if (point_b > point_a)
+						{
+							++pairs_in_range;
+							if (record_neighbors)
+								m_neighbor_table.add_edge(chunk, point_a, point_b, distance_squared);
+						}
+					}
+				}
+			}
+			m_force_x[point_a] = force.x;
+			m_force_y[point_a] = force.y;
+			m_force_z[point_a] = force.z;
+		}
+		if (m_count_pairs)
+		{
+			m_pairs_tested.fetch_add(pairs_tested, std::memory_order_relaxed);
+			m_pairs_in_range.fetch_add(pairs_in_range, std::memory_order_relaxed);
+		}
+	});
+}
+
+// Sums up the cohesive forces from the cached nearby pairs, which hold each pair from both sides so that, as
+// in the gather mode, each point only sums its own force (the candidates are scattered through memory, so
+// this uses a plain loop with an exact square root rather than the vectorized kernel)
+void CohesionSolver::accumulate_forces_verlet(bool record_neighbors)
+{
+	m_scheduler.parallel_for(m_chunks.size(), [this, record_neighbors] (size_t chunk)
+	{
+		uint32_t chunk_start = m_chunks[chunk];
+		uint32_t chunk_end = std::min<uint32_t>(chunk_start + POINTS_PER_CHUNK, get_point_count());
+		// Count pairs locally, then add them to the shared counters once per chunk
+		uint64_t pairs_tested = 0;
+		uint64_t pairs_in_range = 0;
+		for (uint32_t point_a = chunk_start; point_a < chunk_end; ++point_a)
+		{
+			// Dormant points get no force
+			if (m_dormant_count > 0 && is_dormant(point_a))
+			{
+				m_force_x[point_a] = 0.0f;
+				m_force_y[point_a] = 0.0f;
+				m_force_z[point_a] = 0.0f;
+				continue;
+			}
+			Vec3 point_a_position = get_position(point_a);
+			Vec3 force = Vec3::ZERO;
+			// The settings for pairs between this point's domain and each domain
+			const float* pair_force_magnitudes = &m_pair_force_magnitudes[m_point_domains[point_a] * m_domain_count];
+			const float* pair_distances_squared = &m_pair_distances_squared[m_point_domains[point_a] * m_domain_count];
+			uint32_t candidates_end = m_verlet_starts[point_a + 1];
+			for (uint32_t k = m_verlet_starts[point_a]; k < candidates_end; ++k)
+			{
+				uint32_t point_b = m_verlet_candidates[k];
+				Vec3 offset;
+				float distance_squared = get_position(point_b).distance_squared_and_diff(point_a_position, offset);
+				pairs_tested += point_b > point_a;
+				// Points at exactly the same position have no direction to pull in
+				uint32_t domain_b = m_point_domains[point_b];
+				if (distance_squared < pair_distances_squared[domain_b] && distance_squared > 0.0f)
+				{
+					force.add_scaled(offset, pair_force_magnitudes[domain_b] / std::sqrt(distance_squared));
+					if (m_dormant_count > 0 && is_dormant(point_b))
+						m_chunk_disturbed_clusters[chunk].push_back(m_dormant_clusters[point_b]);
+					// Count and record each pair once, from the side of the lower index
+					if (point_b > point_a)
+					{
+						++pairs_in_range;
+						if (record_neighbors)
+							m_neighbor_table.add_edge(chunk, point_a, point_b, distance_squared);
+					}
+				}
+			}
+			m_force_x[point_a] = force.x;
+			m_force_y[point_a] = force.y;
+			m_force_z[point_a] = force.z;
+		}
+		if (m_count_pairs)
+		{
+			m_pairs_tested.fetch_add(pairs_tested, std::memory_order_relaxed);
+			m_pairs_in_range.fetch_add(pairs_in_range, std::memory_order_relaxed);
+		}
+	});
+}
+
+// Collects the nearby pairs for build_neighbor_table() from the cached nearby pairs
+void CohesionSolver::collect_neighbors_verlet()
+{
+	m_scheduler.parallel_for(m_chunks.size(), [this] (size_t chunk)
+	{
+		uint32_t chunk_start = m_chunks[chunk];
+		uint32_t chunk_end = std::min<uint32_t>(chunk_start + POINTS_PER_CHUNK, get_point_count());
+		for (uint32_t point_a = chunk_start; point_a < chunk_end; ++point_a)
+		{
+			Vec3 point_a_position = get_position(point_a);
+			const float* pair_distances_squared = &m_pair_distances_squared[m_point_domains[point_a] * m_domain_count];
+			uint32_t candidates_end = m_verlet_starts[point_a + 1];
+			for (uint32_t k = m_verlet_starts[point_a]; k < candidates_end; ++k)
+			{
+				uint32_t point_b = m_verlet_candidates[k];
+				if (point_b <= point_a)
+					continue;
+				float distance_squared = point_a_position.distance_squared(get_position(point_b));
+				if (distance_squared < pair_distances_squared[m_point_domains[point_b]])
+					m_neighbor_table.add_edge(chunk, point_a, point_b, distance_squared);
+			}
+		}
+	});
+}
+
+// Works out the force magnitude and squared effective distance for every pair of domains, from the domains'
+// own settings and their interaction (pairs across domains use the averages of the two domains' settings, and
+// do not reach at all if they do not interact), along with the largest distance, which sizes the grid
+void CohesionSolver::update_domain_pairs()
+{
+	m_force_magnitude = m_domain_force_magnitudes[0];
+	m_effective_distance = m_domain_effective_distances[0];
+	m_effective_distance_squared = m_effective_distance * m_effective_distance;
+	m_pair_force_magnitudes.resize(m_domain_count * m_domain_count);
+	m_pair_distances_squared.resize(m_domain_count * m_domain_count);
+	m_max_effective_distance = 0.0f;
+	for (uint32_t domain_a = 0; domain_a < m_domain_count; ++domain_a)
+	{
+		for (uint32_t domain_b = 0; domain_b < m_domain_count; ++domain_b)
+		{
+			size_t pair = domain_a * m_domain_count + domain_b;
+			float interaction = m_domain_interactions[pair];
+			float force_magnitude = 0.5f * (m_domain_force_magnitudes[domain_a] + m_domain_force_magnitudes[domain_b]);
+			float effective_distance = 0.5f * (m_domain_effective_distances[domain_a] + m_domain_effective_distances[domain_b]);
+			if (domain_a != domain_b && interaction == 0.0f)
+				effective_distance = 0.0f;
+			m_pair_force_magnitudes[pair] = interaction * force_magnitude;
+			m_pair_distances_squared[pair] = effective_distance * effective_distance;
+			m_max_effective_distance = std::max(m_max_effective_distance, effective_distance);
+		}
+	}
+	m_verlet_list_valid = false;
+}
+
+// Notes the cluster of every dormant point within the effective distance of an awake point, given the
+// distances to a run of points (skipping repeats of the last cluster noted, since nearby points tend to
+// share one)
+void CohesionSolver::record_disturbed_clusters(size_t chunk, const uint32_t* points, const float* distances_squared, uint32_t count)
+{
+	std::vector<uint32_t>& chunk_disturbed_clusters = m_chunk_disturbed_clusters[chunk];
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		uint32_t cluster = m_dormant_clusters[points[i]];
+		if (cluster != NO_DORMANT_CLUSTER && distances_squared[i] < m_effective_distance_squared
+			&& (chunk_disturbed_clusters.empty() || chunk_disturbed_clusters.back() != cluster))
+		{
+			chunk_disturbed_clusters.push_back(cluster);
+		}
+	}
+}
+
+// Whether the cached nearby pairs might be missing a pair, which can only happen once some point has moved
+// more than half the skin since they were built (two points each moving that far can close the whole skin)
+bool CohesionSolver::verlet_list_needs_rebuild() const
+{
+	if (!m_verlet_list_valid || m_verlet_x.size() != get_point_count())
+		return true;
+	float half_skin = 0.5f * m_verlet_skin;
+	float half_skin_squared = half_skin * half_skin;
+	for (uint32_t i = 0; i < get_point_count(); ++i)
+	{
+		float diff_x = m_pos_x[i] - m_verlet_x[i];
+		float diff_y = m_pos_y[i] - m_verlet_y[i];
+		float diff_z = m_pos_z[i] - m_verlet_z[i];
+		if (diff_x * diff_x + diff_y * diff_y + diff_z * diff_z > half_skin_squared)
+			return true;
+	}
+	return false;
+}
+
+// Caches every pair within the effective distance plus the skin from the grid (which has to have just been
+// built from the current positions), and remembers the positions they were found at
+void CohesionSolver::build_verlet_list()
+{
+	float reach = m_max_effective_distance + m_verlet_skin;
+	float reach_squared = reach * reach;
+	const uint32_t* sorted_points = m_grid.get_sorted_points();
+	const float* sorted_x = m_grid.get_sorted_x();
+	const float* sorted_y = m_grid.get_sorted_y();
+	const float* sorted_z = m_grid.get_sorted_z();
+	// Each chunk collects its own points' candidates, and their counts (offset by one, for the prefix sum)
+	m_verlet_starts.assign(get_point_count() + 1, 0);
+	m_verlet_chunk_candidates.resize(m_chunks.size());
+	m_scheduler.parallel_for(m_chunks.size(), [this, reach_squared, sorted_points, sorted_x, sorted_y, sorted_z] (size_t chunk)
+	{
+		uint32_t chunk_start = m_chunks[chunk];
+		uint32_t chunk_end = std::min<uint32_t>(chunk_start + POINTS_PER_CHUNK, get_point_count());
+		std::vector<uint32_t>& chunk_candidates = m_verlet_chunk_candidates[chunk];
+		chunk_candidates.clear();
+		thread_local std::vector<float> distances_squared;
+		for (uint32_t point_a = chunk_start; point_a < chunk_end; ++point_a)
+		{
+			Vec3 point_a_position = get_position(point_a);
+			uint32_t buckets[SpatialHashGrid::MAX_NEIGHBOR_BUCKETS];
+			size_t bucket_count = m_grid.find_neighbor_buckets(point_a_position, buckets);
+			size_t candidate_count = chunk_candidates.size();
+			// The force is thrown away, only the distances are needed
+			Vec3 unused_force = Vec3::ZERO;
+			for (size_t i = 0; i < bucket_count; ++i)
+			{
+				uint32_t bucket_start = m_grid.get_bucket_start(buckets[i]);
+				uint32_t bucket_size = m_grid.get_bucket_end(buckets[i]) - bucket_start;
+				distances_squared.resize(bucket_size);
+				cohesion_kernel_accumulate(sorted_x + bucket_start, sorted_y + bucket_start, sorted_z + bucket_start, bucket_size,
+					point_a_position, reach_squared, 0.0, COHESION_KERNEL_PRECISION_FAST,
+					distances_squared.data(), unused_force);
+				for (uint32_t j = 0; j < bucket_size; ++j)
+				{
+					uint32_t point_b = sorted_points[bucket_start + j];
+					if (distances_squared[j] < reach_squared && point_b != point_a)
+						chunk_candidates.push_back(point_b);
+				}
+			}
+			m_verlet_starts[point_a + 1] = chunk_candidates.size() - candidate_count;
+		}
+	});
+	// Turn the counts into offsets, then copy each chunk's candidates into place (chunks are in point order)
+	for (size_t i = 1; i < m_verlet_starts.size(); ++i)
+	{
+		m_verlet_starts[i] += m_verlet_starts[i - 1];
+	}
+	m_verlet_candidates.resize(m_verlet_starts.back());
+	for (size_t chunk = 0; chunk < m_chunks.size(); ++chunk)
+	{
+		std::copy(m_verlet_chunk_candidates[chunk].begin(), m_verlet_chunk_candidates[chunk].end(),
+			m_verlet_candidates.begin() + m_verlet_starts[m_chunks[chunk]]);
+	}
+	m_verlet_x = m_pos_x;
+	m_verlet_y = m_pos_y;
+	m_verlet_z = m_pos_z;
+	m_verlet_list_valid = true;
+	++m_verlet_rebuild_count;
+}
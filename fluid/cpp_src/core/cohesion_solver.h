@@ -0,0 +1,183 @@
+#ifndef COHESION_SOLVER_H
+#define COHESION_SOLVER_H
+
+#include <vector>
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+#include "vec3.h"
+#include "spatial_hash_grid.h"
+#include "cohesion_kernel.h"
+#include "neighbor_table.h"
+#include "connected_components.h"
+#include "task_scheduler.h"
+#include "morton_order.h"
+
+// How the cohesive forces are summed up in the pair loop
+enum CohesionAccumulationMode
+{
+	// Each pair is visited once, locking both points to add the force to each of them
+	COHESION_ACCUMULATION_MODE_LOCKED,
+	// Each pair is visited twice, once from each side, and each point only sums its own force
+	COHESION_ACCUMULATION_MODE_GATHER
+};
+
+// The cohesion simulation on its own, working on plain arrays of points: it finds nearby pairs with a
+// spatial hash grid, sums the attraction between them, records which points are near each other, and
+// splits the points into connected groups. With a Verlet skin, the nearby pairs are instead looked up once
+// within the effective distance plus the skin and reused until some point has moved more than half the skin.
+// Each point belongs to a domain with its own force magnitude and effective distance, and domains only
+// attract each other as much as their interaction says (not at all, by default). With one domain, the pair
+// loop is the vectorized one; with more, it looks up the settings of each pair as it goes.
+// Points can also be marked dormant (as part of a numbered cluster), which leaves them out of the pair loop
+// apart from pulling on the awake points near them, and reports any cluster an awake point comes close to.
+// It knows nothing about the engine, so whoever owns it copies the positions in, calls the steps in order,
+// and copies the forces back out.
+class CohesionSolver
+{
+public:
+	// The number of points handled together by one task in the pair loop
+	static const uint32_t POINTS_PER_CHUNK = 256;
+	// The number of locks shared between the points in the locked accumulation mode
+	static const size_t FORCE_MUTEX_COUNT = 64;
+	// The most domains a solver can have
+	static constexpr uint32_t MAX_DOMAIN_COUNT = 64;
+	// The dormant cluster of a point that is awake
+	static constexpr uint32_t NO_DORMANT_CLUSTER = UINT32_MAX;
+	// How long (in microseconds) each part of the last call to step() took
+	struct StepTimings
+	{
+		// Properties
+		double grid_usec = 0.0;
+		double pair_loop_usec = 0.0;
+		double neighbor_build_usec = 0.0;
+		double components_usec = 0.0;
+	};
+	// Constructors and Destructors
+	CohesionSolver();
+	~CohesionSolver();
+	// Settings
+	float get_force_magnitude() const;
+	void set_force_magnitude(float force_magnitude);
+	float get_effective_distance() const;
+	void set_effective_distance(float effective_distance);
+	CohesionAccumulationMode get_accumulation_mode() const;
+	void set_accumulation_mode(CohesionAccumulationMode accumulation_mode);
+	CohesionKernelPrecision get_kernel_precision() const;
+	void set_kernel_precision(CohesionKernelPrecision kernel_precision);
+	bool get_count_pairs() const;
+	void set_count_pairs(bool count_pairs);
+	float get_verlet_skin() const;
+	void set_verlet_skin(float verlet_skin);
+	size_t get_thread_count() const;
+	void set_thread_count(size_t thread_count);
+	// Domains
+	uint32_t get_domain_count() const;
+	void set_domain_count(uint32_t domain_count);
+	float get_domain_force_magnitude(uint32_t domain) const;
+	void set_domain_force_magnitude(uint32_t domain, float force_magnitude);
+	float get_domain_effective_distance(uint32_t domain) const;
+	void set_domain_effective_distance(uint32_t domain, float effective_distance);
+	float get_domain_interaction(uint32_t domain_a, uint32_t domain_b) const;
+	void set_domain_interaction(uint32_t domain_a, uint32_t domain_b, float interaction);
+	// Adding and Removing Points
+	void reserve(size_t capacity);
+	uint32_t add_point(const Vec3& position, uint32_t domain = 0);
+	void swap_remove_point(uint32_t index);
+	size_t get_point_count() const;
+	const std::vector<uint32_t>& sort_points_spatially();
+	// Point Data
+	Vec3 get_position(uint32_t index) const;
+	void set_position(uint32_t index, const Vec3& position);
+	const float* get_x() const;
+	const float* get_y() const;
+	const float* get_z() const;
+	Vec3 get_force(uint32_t index) const;
+	uint32_t get_domain(uint32_t index) const;
+	void set_domain(uint32_t index, uint32_t domain);
+	// Dormant Points
+	uint32_t get_dormant_cluster(uint32_t index) const;
+	void set_dormant_cluster(uint32_t index, uint32_t cluster);
+	bool is_dormant(uint32_t index) const;
+	size_t get_dormant_count() const;
+	const std::vector<uint32_t>& get_disturbed_clusters() const;
+	// Stepping the Simulation
+	void update_grid();
+	void accumulate_forces(bool record_neighbors);
+	void collect_neighbors();
+	void build_neighbor_table();
+	void clear_neighbor_table();
+	void build_components();
+	void compute_component_centers(std::vector<Vec3>& centers) const;
+	// Stepping in the Background
+	void step(bool record_neighbors, bool group_components = false);
+	void begin_step(bool record_neighbors, bool group_components = false);
+	void wait_for_step();
+	bool is_step_running() const;
+	const StepTimings& get_step_timings() const;
+	// Querying the Results
+	const NeighborTable& get_neighbor_table() const;
+	const ConnectedComponents& get_components() const;
+	uint64_t get_pairs_tested() const;
+	uint64_t get_pairs_in_range() const;
+	uint64_t get_verlet_rebuild_count() const;
+	uint64_t get_verlet_step_count() const;
+	size_t get_verlet_candidate_count() const;
+private:
+	// Member Variables
+	std::vector<float> m_pos_x, m_pos_y, m_pos_z;
+	std::vector<float> m_force_x, m_force_y, m_force_z;
+	std::vector<uint32_t> m_point_domains;
+	std::array<std::mutex, FORCE_MUTEX_COUNT> m_force_mutexes;
+	SpatialHashGrid m_grid;
+	std::vector<uint32_t> m_chunks;
+	TaskScheduler m_scheduler;
+	NeighborTable m_neighbor_table;
+	ConnectedComponents m_components;
+	float m_force_magnitude;
+	float m_effective_distance;
+	float m_effective_distance_squared;
+	uint32_t m_domain_count;
+	std::vector<float> m_domain_force_magnitudes;
+	std::vector<float> m_domain_effective_distances;
+	std::vector<float> m_domain_interactions;
+	std::vector<float> m_pair_force_magnitudes;
+	std::vector<float> m_pair_distances_squared;
+	float m_max_effective_distance;
+	CohesionAccumulationMode m_accumulation_mode;
+	CohesionKernelPrecision m_kernel_precision;
+	bool m_count_pairs;
+	std::atomic<uint64_t> m_pairs_tested;
+	std::atomic<uint64_t> m_pairs_in_range;
+	StepTimings m_step_timings;
+	MortonOrder m_morton_order;
+	float m_verlet_skin;
+	bool m_verlet_list_valid;
+	std::vector<float> m_verlet_x, m_verlet_y, m_verlet_z;
+	std::vector<uint32_t> m_verlet_starts;
+	std::vector<uint32_t> m_verlet_candidates;
+	std::vector<std::vector<uint32_t>> m_verlet_chunk_candidates;
+	uint64_t m_verlet_rebuild_count;
+	uint64_t m_verlet_step_count;
+	std::vector<uint32_t> m_dormant_clusters;
+	size_t m_dormant_count;
+	std::vector<std::vector<uint32_t>> m_chunk_disturbed_clusters;
+	std::vector<uint32_t> m_disturbed_clusters;
+	// Helper Functions
+	template <typename T>
+	static void permute(std::vector<T>& values, const std::vector<uint32_t>& order);
+	void accumulate_forces_locked(bool record_neighbors);
+	void accumulate_forces_gather(bool record_neighbors);
+	void accumulate_forces_domains(bool record_neighbors);
+	void accumulate_forces_verlet(bool record_neighbors);
+	void collect_neighbors_verlet();
+	void update_domain_pairs();
+	bool verlet_list_needs_rebuild() const;
+	void record_disturbed_clusters(size_t chunk, const uint32_t* points, const float* distances_squared, uint32_t count);
+	void build_verlet_list();
+};
+
+#endif
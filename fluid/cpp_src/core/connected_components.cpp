@@ -0,0 +1,124 @@
+#include "connected_components.h"
+
+// Constructors and Destructors
+
+ConnectedComponents::ConnectedComponents() :
+	m_parents(),
+	m_labels(),
+	m_member_starts(1, 0),
+	m_members()
+{}
+
+ConnectedComponents::~ConnectedComponents()
+{}
+
+// Building the Components
+
+// Groups the points into components, where two points share a component if a chain of edges connects them
+void ConnectedComponents::build(size_t point_count, const std::vector<NeighborTable::Edge>& edges)
+{
+	// Start with every point in a component of its own
+	m_parents.resize(point_count);
+	for (size_t i = 0; i < point_count; ++i)
+	{
+		m_parents[i] = i;
+	}
+	// Merge the components at either end of each edge, always keeping the smaller root so that the result
+	// does not depend on the order of the edges
+	for (const NeighborTable::Edge& edge : edges)
+	{
+		uint32_t root_a = find_root(edge.point_a);
+		uint32_t root_b = find_root(edge.point_b);
+		if (root_a < root_b)
+			m_parents[root_b] = root_a;
+		else if (root_b < root_a)
+			m_parents[root_a] = root_b;
+	}
+	// Number the components in order of their first point
+	m_labels.resize(point_count);
+	m_member_starts.assign(1, 0);
+	for (size_t i = 0; i < point_count; ++i)
+	{
+		uint32_t root = find_root(i);
+		if (root == i)
+		{
+			m_labels[i] = m_member_starts.size() - 1;
+			m_member_starts.push_back(0);
+		}
+		else
+		{
+			// A root always comes before the rest of its component, so it already has a label
+			m_labels[i] = m_labels[root];
+		}
+		++m_member_starts[m_labels[i] + 1];
+	}
+	// Group the points by component (a counting sort, using the starts as cursors)
+	for (size_t i = 1; i < m_member_starts.size(); ++i)
+	{
+		m_member_starts[i] += m_member_starts[i - 1];
+	}
+	m_members.resize(point_count);
+	for (size_t i = 0; i < point_count; ++i)
+	{
+		m_members[m_member_starts[m_labels[i]]++] = i;
+	}
+	for (size_t i = m_member_starts.size() - 1; i > 0; --i)
+	{
+		m_member_starts[i] = m_member_starts[i - 1];
+	}
+	m_member_starts[0] = 0;
+}
+
+// Querying the Components
+
+// Gets the number of components
+size_t ConnectedComponents::get_component_count() const
+{
+	return m_member_starts.size() - 1;
+}
+
+// Gets the component that a point belongs to
+uint32_t ConnectedComponents::get_component(uint32_t point) const
+{
+	return m_labels[point];
+}
+
+// Gets the points that belong to a component
+
+uint32_t ConnectedComponents::get_member_count(uint32_t component) const
+{
+	return m_member_starts[component + 1] - m_member_starts[component];
+}
+
+const uint32_t* ConnectedComponents::get_members(uint32_t component) const
+{
+	return m_members.data() + m_member_starts[component];
+}
+
+// Finds the average position of each component in a single pass over the points
+void ConnectedComponents::compute_centers(const float* x, const float* y, const float* z, std::vector<Vec3>& centers) const
+{
+	centers.assign(get_component_count(), Vec3::ZERO);
+	for (size_t i = 0; i < m_labels.size(); ++i)
+	{
+		centers[m_labels[i]] += Vec3(x[i], y[i], z[i]);
+	}
+	for (size_t component = 0; component < centers.size(); ++component)
+	{
+		centers[component] /= static_cast<float>(get_member_count(component));
+	}
+}
+
+// Helper Functions
+
+// Finds the root of a point's tree, pointing every other node on the way at its grandparent (path halving)
+// so that later searches are shorter
+uint32_t ConnectedComponents::find_root(uint32_t point)
+{
+	while (m_parents[point] != point)
+	{
+		m_parents[point] = m_parents[m_parents[point]];
+		point = m_parents[point];
+	}
+	return point;
+}
@@ -0,0 +1,36 @@
+#ifndef CONNECTED_COMPONENTS_H
+#define CONNECTED_COMPONENTS_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "vec3.h"
+#include "neighbor_table.h"
+
+// Splits a set of points into groups that are connected by edges, using a disjoint-set forest (union-find)
+class ConnectedComponents
+{
+public:
+	// Constructors and Destructors
+	ConnectedComponents();
+	~ConnectedComponents();
+	// Building the Components
+	void build(size_t point_count, const std::vector<NeighborTable::Edge>& edges);
+	// Querying the Components
+	size_t get_component_count() const;
+	uint32_t get_component(uint32_t point) const;
+	uint32_t get_member_count(uint32_t component) const;
+	const uint32_t* get_members(uint32_t component) const;
+	void compute_centers(const float* x, const float* y, const float* z, std::vector<Vec3>& centers) const;
+private:
+	// Member Variables
+	std::vector<uint32_t> m_parents;
+	std::vector<uint32_t> m_labels;
+	std::vector<uint32_t> m_member_starts;
+	std::vector<uint32_t> m_members;
+	// Helper Functions
+	uint32_t find_root(uint32_t point);
+};
+
+#endif
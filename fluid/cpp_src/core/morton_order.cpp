@@ -0,0 +1,124 @@
+#include "morton_order.h"
+
+#include <algorithm>
+#include <cmath>
+#include <array>
+
+// Constructors and Destructors
+
+MortonOrder::MortonOrder() :
+	m_keys(),
+	m_scratch_keys(),
+	m_order(),
+	m_scratch_order()
+{}
+
+MortonOrder::~MortonOrder()
+{}
+
+// Building the Order
+
+// Works out the order of the points along the curve, where each cell is 'cell_size' wide (sizing the cells
+// to the distance points interact over keeps each neighborhood within a few runs of the order)
+void MortonOrder::build(const float* x, const float* y, const float* z, size_t point_count, float cell_size)
+{
+	m_keys.resize(point_count);
+	m_order.resize(point_count);
+	if (point_count == 0)
+		return;
+	// Measure cells from the lowest corner of the points, so that every coordinate is positive
+	float min_x = *std::min_element(x, x + point_count);
+	float min_y = *std::min_element(y, y + point_count);
+	float min_z = *std::min_element(z, z + point_count);
+	float inverse_cell_size = cell_size > 0.0f ? 1.0f / cell_size : 1.0f;
+	// Track the bits any key has set and the bits every key has set, to find the digits the keys differ in
+	uint64_t any_bits = 0;
+	uint64_t every_bits = ~uint64_t(0);
+	for (size_t i = 0; i < point_count; ++i)
+	{
+		uint64_t cell_x = quantize((x[i] - min_x) * inverse_cell_size);
+		uint64_t cell_y = quantize((y[i] - min_y) * inverse_cell_size);
+		uint64_t cell_z = quantize((z[i] - min_z) * inverse_cell_size);
+		m_keys[i] = spread_bits(cell_x) | (spread_bits(cell_y) << 1) | (spread_bits(cell_z) << 2);
+		m_order[i] = i;
+		any_bits |= m_keys[i];
+		every_bits &= m_keys[i];
+	}
+	// Sort 8 bits at a time, from the lowest up to the highest one the keys differ in, skipping any digit
+	// every key shares (each pass is stable, so points in the same cell keep their current order)
+	uint64_t differing_bits = any_bits ^ every_bits;
+	m_scratch_keys.resize(point_count);
+	m_scratch_order.resize(point_count);
+	for (uint32_t shift = 0; shift < 64 && (differing_bits >> shift) != 0; shift += 8)
+	{
+		if (((differing_bits >> shift) & 0xFF) == 0)
+			continue;
+		// Count the keys with each digit, then turn the counts into where each digit starts
+		std::array<uint32_t, 256> digit_starts = {};
+		for (size_t i = 0; i < point_count; ++i)
+		{
+			++digit_starts[(m_keys[i] >> shift) & 0xFF];
+		}
+		uint32_t start = 0;
+		for (uint32_t& digit_start : digit_starts)
+		{
+			uint32_t count = digit_start;
+			digit_start = start;
+			start += count;
+		}
+		// Scatter the keys into place
+		for (size_t i = 0; i < point_count; ++i)
+		{
+			uint32_t destination = digit_starts[(m_keys[i] >> shift) & 0xFF]++;
+			m_scratch_keys[destination] = m_keys[i];
+			m_scratch_order[destination] = m_order[i];
+		}
+		m_keys.swap(m_scratch_keys);
+		m_order.swap(m_scratch_order);
+	}
+}
+
+// Querying the Order
+
+// Gets the order of the points along the curve (the point that belongs at each position)
+const std::vector<uint32_t>& MortonOrder::get_order() const
+{
+	return m_order;
+}
+
+// Whether the points are already in order
+bool MortonOrder::is_identity() const
+{
+	for (size_t i = 0; i < m_order.size(); ++i)
+	{
+		if (m_order[i] != i)
+			return false;
+	}
+	return true;
+}
+
+// Helper Functions
+
+// Turns a distance from the lowest corner (in cells) into a cell coordinate that fits in the key (points
+// that are not a number end up in the first cell)
+uint64_t MortonOrder::quantize(float cells)
+{
+	const float max_cell = (float)((1u << BITS_PER_AXIS) - 1);
+	if (!(cells > 0.0f))
+		return 0;
+	if (cells >= max_cell)
+		return (uint64_t)max_cell;
+	return (uint64_t)cells;
+}
+
+// Spreads out the lowest 21 bits of a value so that there are two zero bits between each of them
+uint64_t MortonOrder::spread_bits(uint64_t value)
+{
+	value &= 0x1FFFFF;
+	value = (value | (value << 32)) & 0x1F00000000FFFFull;
+	value = (value | (value << 16)) & 0x1F0000FF0000FFull;
+	value = (value | (value << 8)) & 0x100F00F00F00F00Full;
+	value = (value | (value << 4)) & 0x10C30C30C30C30C3ull;
+	value = (value | (value << 2)) & 0x1249249249249249ull;
+	return value;
+}
@@ -0,0 +1,37 @@
+#ifndef MORTON_ORDER_H
+#define MORTON_ORDER_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Sorts points along a Morton (Z-order) curve through a grid of cubic cells, so that points that are close
+// together in space mostly end up close together in the order too. The keys interleave the bits of each
+// point's cell coordinates, and are sorted with a least significant digit radix sort (skipping the digits
+// that every key shares). Every buffer keeps its capacity between builds, so sorting again does not allocate.
+class MortonOrder
+{
+public:
+	// The number of bits of each cell coordinate that go into a key (cells further out than this from the
+	// lowest point are clamped)
+	static const uint32_t BITS_PER_AXIS = 21;
+	// Constructors and Destructors
+	MortonOrder();
+	~MortonOrder();
+	// Building the Order
+	void build(const float* x, const float* y, const float* z, size_t point_count, float cell_size);
+	// Querying the Order
+	const std::vector<uint32_t>& get_order() const;
+	bool is_identity() const;
+private:
+	// Member Variables
+	std::vector<uint64_t> m_keys;
+	std::vector<uint64_t> m_scratch_keys;
+	std::vector<uint32_t> m_order;
+	std::vector<uint32_t> m_scratch_order;
+	// Helper Functions
+	static uint64_t quantize(float cells);
+	static uint64_t spread_bits(uint64_t value);
+};
+
+#endif
@@ -0,0 +1,148 @@
+#include "neighbor_table.h"
+
+#include <algorithm>
+
+// Constructors and Destructors
+
+NeighborTable::NeighborTable() :
+	m_chunk_edges(),
+	m_edges(),
+	m_offsets(1, 0),
+	m_neighbors(),
+	m_distances_squared()
+{}
+
+NeighborTable::~NeighborTable()
+{}
+
+// Building the Table
+
+// Gets ready to collect edges for a new set of points, using a separate buffer for each chunk
+void NeighborTable::reset(size_t point_count, size_t chunk_count)
+{
+	m_chunk_edges.resize(chunk_count);
+	for (std::vector<Edge>& chunk_edges : m_chunk_edges)
+	{
+		chunk_edges.clear();
+	}
+	m_offsets.assign(point_count + 1, 0);
+}
+
+// Records that two points are near each other. Each pair should only be added once, and each chunk
+// should only be added to by one thread at a time.
+void NeighborTable::add_edge(size_t chunk, uint32_t point_a, uint32_t point_b, float distance_squared)
+{
+	m_chunk_edges[chunk].push_back(Edge{point_a, point_b, distance_squared});
+}
+
+// Turns the collected edges into the table, listing each edge under both of its points
+void NeighborTable::build()
+{
+	// Gather the edges from every chunk, in chunk order so the result does not depend on thread timing
+	m_edges.clear();
+	for (const std::vector<Edge>& chunk_edges : m_chunk_edges)
+	{
+		m_edges.insert(m_edges.end(), chunk_edges.begin(), chunk_edges.end());
+	}
+	// Count the neighbors of each point
+	for (const Edge& edge : m_edges)
+	{
+		++m_offsets[edge.point_a + 1];
+		++m_offsets[edge.point_b + 1];
+	}
+	// Turn the counts into offsets
+	for (size_t i = 1; i < m_offsets.size(); ++i)
+	{
+		m_offsets[i] += m_offsets[i - 1];
+	}
+	// Place each edge under both of its points (using the offsets as cursors)
+	m_neighbors.resize(2 * m_edges.size());
+	m_distances_squared.resize(2 * m_edges.size());
+	for (const Edge& edge : m_edges)
+	{
+		uint32_t slot_a = m_offsets[edge.point_a]++;
+		m_neighbors[slot_a] = edge.point_b;
+		m_distances_squared[slot_a] = edge.distance_squared;
+		uint32_t slot_b = m_offsets[edge.point_b]++;
+		m_neighbors[slot_b] = edge.point_a;
+		m_distances_squared[slot_b] = edge.distance_squared;
+	}
+	// The cursors now point at the end of each point's neighbors, so shift them back to the start
+	for (size_t i = m_offsets.size() - 1; i > 0; --i)
+	{
+		m_offsets[i] = m_offsets[i - 1];
+	}
+	m_offsets[0] = 0;
+}
+
+// Empties the table, leaving every point without neighbors
+void NeighborTable::clear(size_t point_count)
+{
+	for (std::vector<Edge>& chunk_edges : m_chunk_edges)
+	{
+		chunk_edges.clear();
+	}
+	m_edges.clear();
+	m_offsets.assign(point_count + 1, 0);
+	m_neighbors.clear();
+	m_distances_squared.clear();
+}
+
+// Querying the Table
+
+// Gets the number of points the table was built for
+size_t NeighborTable::get_point_count() const
+{
+	return m_offsets.size() - 1;
+}
+
+// Gets the neighbors of a point, along with their squared distances, in no particular order
+
+uint32_t NeighborTable::get_neighbor_count(uint32_t point) const
+{
+	return m_offsets[point + 1] - m_offsets[point];
+}
+
+const uint32_t* NeighborTable::get_neighbors(uint32_t point) const
+{
+	return m_neighbors.data() + m_offsets[point];
+}
+
+const float* NeighborTable::get_distances_squared(uint32_t point) const
+{
+	return m_distances_squared.data() + m_offsets[point];
+}
+
+// Gets the neighbors of a point sorted from nearest to farthest (sorting a copy, so only callers that
+// need the order pay for it)
+void NeighborTable::get_sorted_neighbors(uint32_t point, std::vector<uint32_t>& sorted_neighbors) const
+{
+	uint32_t start = m_offsets[point];
+	uint32_t count = get_neighbor_count(point);
+	std::vector<uint32_t> slots(count);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		slots[i] = start + i;
+	}
+	std::sort(slots.begin(), slots.end(), [this] (uint32_t slot_a, uint32_t slot_b)
+	{
+		return m_distances_squared[slot_a] < m_distances_squared[slot_b];
+	});
+	sorted_neighbors.resize(count);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		sorted_neighbors[i] = m_neighbors[slots[i]];
+	}
+}
+
+// Gets every pair of nearby points (each pair appears once)
+
+size_t NeighborTable::get_edge_count() const
+{
+	return m_edges.size();
+}
+
+const std::vector<NeighborTable::Edge>& NeighborTable::get_edges() const
+{
+	return m_edges;
+}
@@ -0,0 +1,48 @@
+#ifndef NEIGHBOR_TABLE_H
+#define NEIGHBOR_TABLE_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// A table of which points are near each other, stored in compressed sparse row form (one flat array of
+// neighbors, with an offset per point saying where its neighbors start). It is filled from a list of
+// pairs that can be collected in parallel, one chunk per thread, and every buffer keeps its capacity
+// between builds so that rebuilding the table every frame does not allocate.
+class NeighborTable
+{
+public:
+	// A pair of nearby points
+	struct Edge
+	{
+		// Properties
+		uint32_t point_a;
+		uint32_t point_b;
+		float distance_squared;
+	};
+	// Constructors and Destructors
+	NeighborTable();
+	~NeighborTable();
+	// Building the Table
+	void reset(size_t point_count, size_t chunk_count);
+	void add_edge(size_t chunk, uint32_t point_a, uint32_t point_b, float distance_squared);
+	void build();
+	void clear(size_t point_count);
+	// Querying the Table
+	size_t get_point_count() const;
+	uint32_t get_neighbor_count(uint32_t point) const;
+	const uint32_t* get_neighbors(uint32_t point) const;
+	const float* get_distances_squared(uint32_t point) const;
+	void get_sorted_neighbors(uint32_t point, std::vector<uint32_t>& sorted_neighbors) const;
+	size_t get_edge_count() const;
+	const std::vector<Edge>& get_edges() const;
+private:
+	// Member Variables
+	std::vector<std::vector<Edge>> m_chunk_edges;
+	std::vector<Edge> m_edges;
+	std::vector<uint32_t> m_offsets;
+	std::vector<uint32_t> m_neighbors;
+	std::vector<float> m_distances_squared;
+};
+
+#endif
@@ -0,0 +1,232 @@
+#include "spatial_hash_grid.h"
+
+#include <cmath>
+#include <cassert>
+
+// NeighborCandidates Methods
+
+// Gets the number of candidates
+size_t SpatialHashGrid::NeighborCandidates::size() const
+{
+	return points.size();
+}
+
+
+
+// Constructors and Destructors
+
+SpatialHashGrid::SpatialHashGrid() :
+	m_cell_size(1.0),
+	m_inverse_cell_size(1.0),
+	m_bucket_mask(0),
+	m_point_buckets(),
+	m_point_positions(),
+	m_bucket_starts(),
+	m_sorted_points(),
+	m_sorted_x(),
+	m_sorted_y(),
+	m_sorted_z()
+{}
+
+SpatialHashGrid::~SpatialHashGrid()
+{}
+
+// Building the Grid
+
+// Clears out the grid and sizes it for a new set of points. The cell size should be at least the
+// largest query distance, so that every point within range lies in one of the 27 surrounding cells. It
+// must also be positive: callers skip building the grid when no pair can interact (as update_grid does).
+void SpatialHashGrid::reset(float cell_size, size_t point_count)
+{
+	assert(cell_size > 0.0f && "SpatialHashGrid cell size must be positive");
+	m_cell_size = cell_size;
+	m_inverse_cell_size = 1.0 / cell_size;
+	// Use a power of two with roughly two buckets per point to keep hash collisions rare
+	uint32_t bucket_count = 1;
+	while (bucket_count < 2 * point_count)
+		bucket_count <<= 1;
+	m_bucket_mask = bucket_count - 1;
+	// Vectors keep their capacity, so this does not allocate once the droplet count settles
+	m_point_buckets.resize(point_count);
+	m_point_positions.resize(point_count);
+	m_bucket_starts.assign(bucket_count + 1, 0);
+	m_sorted_points.resize(point_count);
+	m_sorted_x.resize(point_count);
+	m_sorted_y.resize(point_count);
+	m_sorted_z.resize(point_count);
+}
+
+// Records the position of a point and which bucket it falls into. Safe to call in parallel for distinct indices.
+void SpatialHashGrid::set_point(size_t index, const Vec3& position)
+{
+	m_point_positions[index] = position;
+	m_point_buckets[index] = hash_cell(cell_coordinate(position.x),
+		cell_coordinate(position.y),
+		cell_coordinate(position.z));
+}
+
+// Sorts the points by bucket (a counting sort), must be called after every point has been set. The
+// positions are copied into the same order, so the points in a bucket are contiguous in memory.
+void SpatialHashGrid::build()
+{
+	// Count the points in each bucket
+	for (uint32_t bucket : m_point_buckets)
+	{
+		++m_bucket_starts[bucket + 1];
+	}
+	// Turn the counts into starting offsets
+	for (size_t i = 1; i < m_bucket_starts.size(); ++i)
+	{
+		m_bucket_starts[i] += m_bucket_starts[i - 1];
+	}
+	// Place each point index into its bucket (using the end of the previous bucket as a cursor)
+	for (size_t i = 0; i < m_point_buckets.size(); ++i)
+	{
+		m_sorted_points[m_bucket_starts[m_point_buckets[i]]++] = i;
+	}
+	// The cursors now point at the end of each bucket, so shift them back to the start
+	for (size_t i = m_bucket_starts.size() - 1; i > 0; --i)
+	{
+		m_bucket_starts[i] = m_bucket_starts[i - 1];
+	}
+	m_bucket_starts[0] = 0;
+	// Copy the positions into bucket order
+	for (size_t i = 0; i < m_sorted_points.size(); ++i)
+	{
+		const Vec3& position = m_point_positions[m_sorted_points[i]];
+		m_sorted_x[i] = position.x;
+		m_sorted_y[i] = position.y;
+		m_sorted_z[i] = position.z;
+	}
+}
+
+// Querying the Grid
+
+// Fills 'buckets' with the unique buckets covering the 27 cells around a position and returns how
+// many there are. 'buckets' must have room for MAX_NEIGHBOR_BUCKETS entries. Different cells can
+// hash into the same bucket, so duplicates are skipped to avoid visiting a point twice.
+size_t SpatialHashGrid::find_neighbor_buckets(const Vec3& position, uint32_t* buckets) const
+{
+	size_t bucket_count = 0;
+	int center_x = cell_coordinate(position.x);
+	int center_y = cell_coordinate(position.y);
+	int center_z = cell_coordinate(position.z);
+	for (int x = center_x - 1; x <= center_x + 1; ++x)
+	{
+		for (int y = center_y - 1; y <= center_y + 1; ++y)
+		{
+			for (int z = center_z - 1; z <= center_z + 1; ++z)
+			{
+				uint32_t bucket = hash_cell(x, y, z);
+				// Skip empty buckets and buckets that have already been found
+				if (m_bucket_starts[bucket] == m_bucket_starts[bucket + 1])
+					continue;
+				bool is_duplicate = false;
+				for (size_t i = 0; i < bucket_count && !is_duplicate; ++i)
+				{
+					is_duplicate = buckets[i] == bucket;
+				}
+				if (!is_duplicate)
+				{
+					buckets[bucket_count++] = bucket;
+				}
+			}
+		}
+	}
+	return bucket_count;
+}
+
+// Gets the range of a bucket within the sorted arrays
+
+// Copies the points in the buckets around a position (and their positions) into the candidates, unless they
+// already hold the ones around the same cell, as they do for consecutive points in the same cell once the points
+// are sorted spatially. Returns whether they were copied. Candidates must be marked invalid after the grid is rebuilt.
+bool SpatialHashGrid::gather_neighbor_candidates(const Vec3& position, NeighborCandidates& candidates) const
+{
+	int cell_x = cell_coordinate(position.x);
+	int cell_y = cell_coordinate(position.y);
+	int cell_z = cell_coordinate(position.z);
+	if (candidates.is_valid && candidates.cell_x == cell_x && candidates.cell_y == cell_y && candidates.cell_z == cell_z)
+		return false;
+	uint32_t buckets[MAX_NEIGHBOR_BUCKETS];
+	size_t bucket_count = find_neighbor_buckets(position, buckets);
+	candidates.points.clear();
+	candidates.x.clear();
+	candidates.y.clear();
+	candidates.z.clear();
+	for (size_t i = 0; i < bucket_count; ++i)
+	{
+		uint32_t bucket_start = m_bucket_starts[buckets[i]];
+		uint32_t bucket_end = m_bucket_starts[buckets[i] + 1];
+		candidates.points.insert(candidates.points.end(), m_sorted_points.begin() + bucket_start, m_sorted_points.begin() + bucket_end);
+		candidates.x.insert(candidates.x.end(), m_sorted_x.begin() + bucket_start, m_sorted_x.begin() + bucket_end);
+		candidates.y.insert(candidates.y.end(), m_sorted_y.begin() + bucket_start, m_sorted_y.begin() + bucket_end);
+		candidates.z.insert(candidates.z.end(), m_sorted_z.begin() + bucket_start, m_sorted_z.begin() + bucket_end);
+	}
+	candidates.cell_x = cell_x;
+	candidates.cell_y = cell_y;
+	candidates.cell_z = cell_z;
+	candidates.is_valid = true;
+	return true;
+}
+
+uint32_t SpatialHashGrid::get_bucket_start(uint32_t bucket) const
+{
+	return m_bucket_starts[bucket];
+}
+
+uint32_t SpatialHashGrid::get_bucket_end(uint32_t bucket) const
+{
+	return m_bucket_starts[bucket + 1];
+}
+
+// Getters for the point indices and positions in bucket order
+
+const uint32_t* SpatialHashGrid::get_sorted_points() const
+{
+	return m_sorted_points.data();
+}
+
+const float* SpatialHashGrid::get_sorted_x() const
+{
+	return m_sorted_x.data();
+}
+
+const float* SpatialHashGrid::get_sorted_y() const
+{
+	return m_sorted_y.data();
+}
+
+const float* SpatialHashGrid::get_sorted_z() const
+{
+	return m_sorted_z.data();
+}
+
+// Getters for the cell size and number of points
+
+float SpatialHashGrid::get_cell_size() const
+{
+	return m_cell_size;
+}
+
+size_t SpatialHashGrid::get_point_count() const
+{
+	return m_point_buckets.size();
+}
+
+// Helper Functions
+
+// Converts a position along one axis into a cell coordinate
+int SpatialHashGrid::cell_coordinate(float position) const
+{
+	return static_cast<int>(std::floor(position * m_inverse_cell_size));
+}
+
+// Hashes a cell's coordinates into a bucket
+uint32_t SpatialHashGrid::hash_cell(int cell_x, int cell_y, int cell_z) const
+{
+	uint32_t hash = static_cast<uint32_t>(cell_x) * 73856093u ^
+		static_cast<uint32_t>(cell_y) * 19349663u ^
+		static_cast<uint32_t>(cell_z) * 83492791u;
+	return hash & m_bucket_mask;
+}
@@ -0,0 +1,61 @@
+#ifndef SPATIAL_HASH_GRID_H
+#define SPATIAL_HASH_GRID_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "vec3.h"
+
+// A uniform grid of cubic cells, hashed into a fixed number of buckets, used to find nearby points
+class SpatialHashGrid
+{
+public:
+	// The maximum number of buckets returned by find_neighbor_buckets()
+	static const size_t MAX_NEIGHBOR_BUCKETS = 27;
+	// The points in the cells around one cell, copied into one contiguous run so that a kernel can stream
+	// through all of them at once (rather than a few at a time, bucket by bucket)
+	struct NeighborCandidates
+	{
+		// Properties
+		std::vector<uint32_t> points;
+		std::vector<float> x, y, z;
+		int cell_x = 0, cell_y = 0, cell_z = 0;
+		bool is_valid = false;
+		// Methods
+		size_t size() const;
+	};
+	// Constructors and Destructors
+	SpatialHashGrid();
+	~SpatialHashGrid();
+	// Building the Grid
+	void reset(float cell_size, size_t point_count);
+	void set_point(size_t index, const Vec3& position);
+	void build();
+	// Querying the Grid
+	size_t find_neighbor_buckets(const Vec3& position, uint32_t* buckets) const;
+	bool gather_neighbor_candidates(const Vec3& position, NeighborCandidates& candidates) const;
+	uint32_t get_bucket_start(uint32_t bucket) const;
+	uint32_t get_bucket_end(uint32_t bucket) const;
+	const uint32_t* get_sorted_points() const;
+	const float* get_sorted_x() const;
+	const float* get_sorted_y() const;
+	const float* get_sorted_z() const;
+	float get_cell_size() const;
+	size_t get_point_count() const;
+private:
+	// Member Variables
+	float m_cell_size;
+	float m_inverse_cell_size;
+	uint32_t m_bucket_mask;
+	std::vector<uint32_t> m_point_buckets;
+	std::vector<Vec3> m_point_positions;
+	std::vector<uint32_t> m_bucket_starts;
+	std::vector<uint32_t> m_sorted_points;
+	std::vector<float> m_sorted_x, m_sorted_y, m_sorted_z;
+	// Helper Functions
+	int cell_coordinate(float position) const;
+	uint32_t hash_cell(int cell_x, int cell_y, int cell_z) const;
+};
+
+#endif
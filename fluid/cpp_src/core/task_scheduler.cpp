@@ -0,0 +1,236 @@
+#include "task_scheduler.h"
+
+#include <algorithm>
+
+// Constructors and Destructors
+
+TaskScheduler::TaskScheduler() :
+	m_thread_count(0),
+	m_threads(),
+	m_ranges(),
+	m_range_count(0),
+	m_mutex(),
+	m_start_condition(),
+	m_done_condition(),
+	m_function(nullptr),
+	m_generation(0),
+	m_busy_threads(0),
+	m_stopping(false),
+	m_background_thread(),
+	m_background_mutex(),
+	m_background_condition(),
+	m_background_job(),
+	m_background_busy(false),
+	m_background_stopping(false)
+{}
+
+TaskScheduler::~TaskScheduler()
+{
+	// The background job may be using the worker threads, so it has to finish first
+	if (m_background_thread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_background_mutex);
+			m_background_stopping = true;
+		}
+		m_background_condition.notify_all();
+		m_background_thread.join();
+	}
+	stop_threads();
+}
+
+// Settings
+
+// The number of threads that run each loop, including the calling thread (0 means one per CPU core)
+size_t TaskScheduler::get_thread_count() const
+{
+	return m_thread_count;
+}
+
+// Takes effect on the next loop (the current threads are stopped, and new ones are started when needed)
+void TaskScheduler::set_thread_count(size_t thread_count)
+{
+	if (thread_count == m_thread_count)
+		return;
+	stop_threads();
+	m_thread_count = thread_count;
+}
+
+// Gets the number of threads that will actually run each loop
+size_t TaskScheduler::get_active_thread_count() const
+{
+	if (m_thread_count > 0)
+		return m_thread_count;
+	return std::max<size_t>(std::thread::hardware_concurrency(), 1);
+}
+
+// Running Loops
+
+// Runs the function once for every task index from 0 up to the task count, spread across the threads, and
+// returns once all of them have finished
+void TaskScheduler::parallel_for(size_t task_count, const TaskFunction& function)
+{
+	size_t thread_count = std::min(get_active_thread_count(), task_count);
+	// Not worth waking anyone up for
+	if (thread_count <= 1)
+	{
+		for (size_t task = 0; task < task_count; ++task)
+		{
+			function(task);
+		}
+		return;
+	}
+	if (m_threads.empty())
+		start_threads();
+	// Give each thread an equal share of the tasks (threads beyond the task count get an empty range)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (size_t worker = 0; worker < m_range_count; ++worker)
+		{
+			m_ranges[worker].next.store(std::min(task_count, task_count * worker / thread_count), std::memory_order_relaxed);
+			m_ranges[worker].end = std::min(task_count, task_count * (worker + 1) / thread_count);
+		}
+		m_function = &function;
+		m_busy_threads = m_threads.size();
+		++m_generation;
+	}
+	m_start_condition.notify_all();
+	// Work alongside the other threads, then wait for them to finish
+	run_tasks(0);
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_done_condition.wait(lock, [this] () { return m_busy_threads == 0; });
+	m_function = nullptr;
+}
+
+// Running in the Background
+
+// Starts a job on the background thread (waiting for the previous one first, if it is still running). The
+// job may run parallel loops on this scheduler, so nothing else should until wait_for_background() returns.
+void TaskScheduler::run_in_background(const JobFunction& job)
+{
+	wait_for_background();
+	if (!m_background_thread.joinable())
+	{
+		m_background_stopping = false;
+		m_background_thread = std::thread(&TaskScheduler::background_loop, this);
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_background_mutex);
+		m_background_job = job;
+		m_background_busy = true;
+	}
+	m_background_condition.notify_all();
+}
+
+// Blocks until the background job (if any) has finished
+void TaskScheduler::wait_for_background()
+{
+	std::unique_lock<std::mutex> lock(m_background_mutex);
+	m_background_condition.wait(lock, [this] () { return !m_background_busy; });
+}
+
+bool TaskScheduler::is_background_busy() const
+{
+	std::lock_guard<std::mutex> lock(m_background_mutex);
+	return m_background_busy;
+}
+
+// Helper Functions
+
+// Starts a thread for every range but the first one (which belongs to the calling thread)
+void TaskScheduler::start_threads()
+{
+	m_range_count = get_active_thread_count();
+	m_ranges.reset(new TaskRange[m_range_count]);
+	for (size_t worker = 0; worker < m_range_count; ++worker)
+	{
+		m_ranges[worker].next.store(0, std::memory_order_relaxed);
+		m_ranges[worker].end = 0;
+	}
+	m_stopping = false;
+	for (size_t worker = 1; worker < m_range_count; ++worker)
+	{
+		m_threads.emplace_back(&TaskScheduler::worker_loop, this, worker);
+	}
+}
+
+// Wakes up every thread to tell it to exit, then waits for them to do so
+void TaskScheduler::stop_threads()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_start_condition.notify_all();
+	for (std::thread& thread : m_threads)
+	{
+		thread.join();
+	}
+	m_threads.clear();
+	m_ranges.reset();
+	m_range_count = 0;
+	// New threads start out having seen generation zero
+	m_generation = 0;
+}
+
+// Sleeps until there is a loop to run or the scheduler is stopping
+void TaskScheduler::worker_loop(size_t worker)
+{
+	uint64_t seen_generation = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_start_condition.wait(lock, [this, seen_generation] () { return m_stopping || m_generation != seen_generation; });
+			if (m_stopping)
+				return;
+			seen_generation = m_generation;
+		}
+		run_tasks(worker);
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			--m_busy_threads;
+			if (m_busy_threads == 0)
+				m_done_condition.notify_one();
+		}
+	}
+}
+
+// Runs the tasks in a thread's own range, then steals from the other ranges until there are none left
+void TaskScheduler::run_tasks(size_t worker)
+{
+	const TaskFunction& function = *m_function;
+	for (size_t i = 0; i < m_range_count; ++i)
+	{
+		// Start with its own range, then go around the others
+		TaskRange& range = m_ranges[(worker + i) % m_range_count];
+		// Owners and thieves both claim tasks from the front, so each task is run exactly once
+		for (size_t task = range.next.fetch_add(1, std::memory_order_relaxed); task < range.end;
+			task = range.next.fetch_add(1, std::memory_order_relaxed))
+		{
+			function(task);
+		}
+	}
+}
+
+// Sleeps until there is a background job to run or the scheduler is being destroyed
+void TaskScheduler::background_loop()
+{
+	while (true)
+	{
+		JobFunction job;
+		{
+			std::unique_lock<std::mutex> lock(m_background_mutex);
+			m_background_condition.wait(lock, [this] () { return m_background_stopping || m_background_busy; });
+			if (m_background_stopping)
+				return;
+			job.swap(m_background_job);
+		}
+		job();
+		{
+			std::lock_guard<std::mutex> lock(m_background_mutex);
+			m_background_busy = false;
+		}
+		m_background_condition.notify_all();
+	}
+}
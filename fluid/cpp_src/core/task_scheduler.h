@@ -0,0 +1,74 @@
+#ifndef TASK_SCHEDULER_H
+#define TASK_SCHEDULER_H
+
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+// A fixed set of worker threads that run parallel loops. Each loop's tasks are split into one contiguous
+// range per thread, and a thread that finishes its own range steals tasks from the others, so uneven tasks
+// still keep every thread busy. The threads are started on the first loop and then sleep between loops,
+// and the calling thread always takes part. Only one loop can run at a time, so a scheduler should only be
+// used from one thread at a time. That thread can also be the scheduler's background thread, which runs
+// one job at a time (such as a whole solver step) while the thread that started it gets on with other work.
+class TaskScheduler
+{
+public:
+	// The function run for each task, given the index of the task
+	typedef std::function<void(size_t)> TaskFunction;
+	// The function run by the background thread
+	typedef std::function<void()> JobFunction;
+	// Constructors and Destructors
+	TaskScheduler();
+	~TaskScheduler();
+	// Settings
+	size_t get_thread_count() const;
+	void set_thread_count(size_t thread_count);
+	size_t get_active_thread_count() const;
+	// Running Loops
+	void parallel_for(size_t task_count, const TaskFunction& function);
+	// Running in the Background
+	void run_in_background(const JobFunction& job);
+	void wait_for_background();
+	bool is_background_busy() const;
+private:
+	// The tasks that one thread starts with, on its own cache line since other threads steal from it
+	struct alignas(64) TaskRange
+	{
+		// Properties
+		std::atomic<size_t> next;
+		size_t end;
+	};
+	// Member Variables
+	size_t m_thread_count;
+	std::vector<std::thread> m_threads;
+	std::unique_ptr<TaskRange[]> m_ranges;
+	size_t m_range_count;
+	std::mutex m_mutex;
+	std::condition_variable m_start_condition;
+	std::condition_variable m_done_condition;
+	const TaskFunction* m_function;
+	uint64_t m_generation;
+	size_t m_busy_threads;
+	bool m_stopping;
+	std::thread m_background_thread;
+	mutable std::mutex m_background_mutex;
+	std::condition_variable m_background_condition;
+	JobFunction m_background_job;
+	bool m_background_busy;
+	bool m_background_stopping;
+	// Helper Functions
+	void start_threads();
+	void stop_threads();
+	void worker_loop(size_t worker);
+	void run_tasks(size_t worker);
+	void background_loop();
+};
+
+#endif
@@ -0,0 +1,105 @@
+#ifndef VEC_3_H
+#define VEC_3_H
+
+#include <cmath>
+#include <type_traits>
+
+// A plain 3D vector of floats. Everything is defined inline in this header (and is constexpr where the
+// standard library allows it), and copying is left to the compiler, so that the pair loops can keep
+// vectors in registers instead of calling out to another translation unit for every operation.
+class Vec3
+{
+public:
+	// Member Variables
+	float x, y, z;
+	// Constant Members Variables
+	static const Vec3 ZERO;
+	static const Vec3 UP;
+	static const Vec3 DOWN;
+	static const Vec3 LEFT;
+	static const Vec3 RIGHT;
+	static const Vec3 FORE;
+	static const Vec3 BACK;
+	// Constructors
+	constexpr Vec3() : x(0.0f), y(0.0f), z(0.0f) {}
+	constexpr Vec3(float xyz) : x(xyz), y(xyz), z(xyz) {}
+	constexpr Vec3(float p_x, float p_y, float p_z) : x(p_x), y(p_y), z(p_z) {}
+	// Overloaded Assignment Operators
+	constexpr Vec3& operator += (const Vec3& other_vec3) { x += other_vec3.x; y += other_vec3.y; z += other_vec3.z; return *this; }
+	constexpr Vec3& operator -= (const Vec3& other_vec3) { x -= other_vec3.x; y -= other_vec3.y; z -= other_vec3.z; return *this; }
+	constexpr Vec3& operator *= (const Vec3& other_vec3) { x *= other_vec3.x; y *= other_vec3.y; z *= other_vec3.z; return *this; }
+	constexpr Vec3& operator *= (const float other_float) { x *= other_float; y *= other_float; z *= other_float; return *this; }
+	constexpr Vec3& operator /= (const Vec3& other_vec3) { x /= other_vec3.x; y /= other_vec3.y; z /= other_vec3.z; return *this; }
+	constexpr Vec3& operator /= (const float other_float) { x /= other_float; y /= other_float; z /= other_float; return *this; }
+	// Member Functions
+	constexpr float length_squared() const { return x * x + y * y + z * z; }
+	constexpr float dot(const Vec3& other_vec3) const { return x * other_vec3.x + y * other_vec3.y + z * other_vec3.z; }
+	constexpr float distance_squared(const Vec3& other_vec3) const;
+	float length() const { return std::sqrt(length_squared()); }
+	float distance(const Vec3& other_vec3) const { return std::sqrt(distance_squared(other_vec3)); }
+	Vec3 normalized() const;
+	// Fused Helpers
+	constexpr float distance_squared_and_diff(const Vec3& other_vec3, Vec3& diff) const;
+	constexpr Vec3& add_scaled(const Vec3& other_vec3, float scale);
+};
+
+// Overloaded Binary Operators
+constexpr Vec3 operator + (const Vec3& left_vec3, const Vec3& right_vec3) { return Vec3(left_vec3.x + right_vec3.x, left_vec3.y + right_vec3.y, left_vec3.z + right_vec3.z); }
+constexpr Vec3 operator - (const Vec3& left_vec3, const Vec3& right_vec3) { return Vec3(left_vec3.x - right_vec3.x, left_vec3.y - right_vec3.y, left_vec3.z - right_vec3.z); }
+constexpr Vec3 operator * (const Vec3& left_vec3, const Vec3& right_vec3) { return Vec3(left_vec3.x * right_vec3.x, left_vec3.y * right_vec3.y, left_vec3.z * right_vec3.z); }
+constexpr Vec3 operator / (const Vec3& left_vec3, const Vec3& right_vec3) { return Vec3(left_vec3.x / right_vec3.x, left_vec3.y / right_vec3.y, left_vec3.z / right_vec3.z); }
+constexpr Vec3 operator * (const Vec3& left_vec3, const float right_float) { return Vec3(left_vec3.x * right_float, left_vec3.y * right_float, left_vec3.z * right_float); }
+constexpr Vec3 operator / (const Vec3& left_vec3, const float right_float) { return Vec3(left_vec3.x / right_float, left_vec3.y / right_float, left_vec3.z / right_float); }
+constexpr Vec3 operator * (const float left_float, const Vec3& right_vec3) { return Vec3(left_float * right_vec3.x, left_float * right_vec3.y, left_float * right_vec3.z); }
+constexpr Vec3 operator / (const float left_float, const Vec3& right_vec3) { return Vec3(left_float / right_vec3.x, left_float / right_vec3.y, left_float / right_vec3.z); }
+constexpr Vec3 operator - (const Vec3& vec3) { return Vec3(-vec3.x, -vec3.y, -vec3.z); }
+constexpr bool operator == (const Vec3& left_vec3, const Vec3& right_vec3) { return left_vec3.x == right_vec3.x && left_vec3.y == right_vec3.y && left_vec3.z == right_vec3.z; }
+constexpr bool operator != (const Vec3& left_vec3, const Vec3& right_vec3) { return !(left_vec3 == right_vec3); }
+
+// Constant Member Variables (const rather than constexpr, since Vec3 is incomplete inside its own definition)
+
+inline const Vec3 Vec3::ZERO = Vec3(0.0f, 0.0f, 0.0f);
+inline const Vec3 Vec3::UP = Vec3(0.0f, 1.0f, 0.0f);
+inline const Vec3 Vec3::DOWN = Vec3(0.0f, -1.0f, 0.0f);
+inline const Vec3 Vec3::LEFT = Vec3(-1.0f, 0.0f, 0.0f);
+inline const Vec3 Vec3::RIGHT = Vec3(1.0f, 0.0f, 0.0f);
+inline const Vec3 Vec3::FORE = Vec3(0.0f, 0.0f, 1.0f);
+inline const Vec3 Vec3::BACK = Vec3(0.0f, 0.0f, -1.0f);
+
+// Member Functions
+
+constexpr float Vec3::distance_squared(const Vec3& other_vec3) const
+{
+	return (*this - other_vec3).length_squared();
+}
+
+inline Vec3 Vec3::normalized() const
+{
+	return *this / length();
+}
+
+// Fused Helpers
+
+// Gets the squared distance to another vector, and also writes the difference (this minus the other vector)
+// into 'diff', so a pair loop that goes on to use the direction does not have to subtract twice
+constexpr float Vec3::distance_squared_and_diff(const Vec3& other_vec3, Vec3& diff) const
+{
+	diff = *this - other_vec3;
+	return diff.length_squared();
+}
+
+// Adds another vector multiplied by a scale (this += other * scale), which compilers can turn into fused
+// multiply-adds
+constexpr Vec3& Vec3::add_scaled(const Vec3& other_vec3, float scale)
+{
+	x += other_vec3.x * scale;
+	y += other_vec3.y * scale;
+	z += other_vec3.z * scale;
+	return *this;
+}
+
+// The pair loops pass vectors around by value, which is only free if they stay plain floats
+static_assert(std::is_trivially_copyable<Vec3>::value, "Vec3 must be trivially copyable");
+static_assert(sizeof(Vec3) == 3 * sizeof(float), "Vec3 must be three packed floats");
+
+#endif
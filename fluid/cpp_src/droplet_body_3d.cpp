@@ -8,7 +8,7 @@ using namespace godot;
 // Needed for exposing stuff to Godot
 void DropletBody3D::_bind_methods()
 {
-	// Methods: add_nearby_droplet, remove_nearby_droplet, and clear_nearby_droplets
+	// Methods: add_nearby_droplet, remove_nearby_droplet, and clear_nearby_droplets (deprecated)
 	ClassDB::bind_method(D_METHOD("add_nearby_droplet", "new_droplet_body", "new_distance_squared"), &DropletBody3D::add_nearby_droplet, DEFVAL(-1.0));
 	ClassDB::bind_method(D_METHOD("remove_nearby_droplet", "old_droplet_body"), &DropletBody3D::remove_nearby_droplet);
 	ClassDB::bind_method(D_METHOD("clear_nearby_droplets"), &DropletBody3D::clear_nearby_droplets);
@@ -27,60 +27,11 @@ void DropletBody3D::_bind_methods()
 	ClassDB::bind_method(D_METHOD("get_liquid_material"), &DropletBody3D::get_liquid_material);
 	ClassDB::bind_method(D_METHOD("set_liquid_material", "liquid_material"), &DropletBody3D::set_liquid_material);
 	ClassDB::add_property("DropletBody3D", PropertyInfo(Variant::OBJECT, "liquid_material", PROPERTY_HINT_RESOURCE_TYPE, "Material"), "set_liquid_material", "get_liquid_material");
-}
-
-
-
-// NearbyDroplet Methods
-
-// Constructors
-DropletBody3D::NearbyDroplet::NearbyDroplet() :
-	body(nullptr),
-	distance_squared(-1.0)
-{}
-DropletBody3D::NearbyDroplet::NearbyDroplet(DropletBody3D* p_body) :
-	body(p_body),
-	distance_squared(-1.0)
-{}
-DropletBody3D::NearbyDroplet::NearbyDroplet(DropletBody3D* p_body, float p_distance_squared) :
-	body(p_body),
-	distance_squared(p_distance_squared)
-{}
 
-// Comparison operators
-bool DropletBody3D::NearbyDroplet::operator < (const NearbyDroplet& other_nearby_droplet) const
-{
-	if (distance_squared == other_nearby_droplet.distance_squared)
-	{
-		return body < other_nearby_droplet.body;
-	}
-	else
-	{
-		return distance_squared < other_nearby_droplet.distance_squared;
-	}
-}
-bool DropletBody3D::NearbyDroplet::operator > (const NearbyDroplet& other_nearby_droplet) const
-{
-	if (distance_squared == other_nearby_droplet.distance_squared)
-	{
-		return body > other_nearby_droplet.body;
-	}
-	else
-	{
-		return distance_squared > other_nearby_droplet.distance_squared;
-	}
-}
-bool DropletBody3D::NearbyDroplet::operator == (const NearbyDroplet& other_nearby_droplet) const
-{
-	return distance_squared == other_nearby_droplet.distance_squared && body == other_nearby_droplet.body;
-}
-bool DropletBody3D::NearbyDroplet::operator <= (const NearbyDroplet& other_nearby_droplet) const
-{
-	return *this < other_nearby_droplet || *this == other_nearby_droplet;
-}
-bool DropletBody3D::NearbyDroplet::operator >= (const NearbyDroplet& other_nearby_droplet) const
-{
-	return *this > other_nearby_droplet || *this == other_nearby_droplet;
+	// Property: mesh_visible
+	ClassDB::bind_method(D_METHOD("is_mesh_visible"), &DropletBody3D::is_mesh_visible);
+	ClassDB::bind_method(D_METHOD("set_mesh_visible", "mesh_visible"), &DropletBody3D::set_mesh_visible);
+	ClassDB::add_property("DropletBody3D", PropertyInfo(Variant::BOOL, "mesh_visible"), "set_mesh_visible", "is_mesh_visible");
 }
 
 
@@ -89,13 +40,12 @@ bool DropletBody3D::NearbyDroplet::operator >= (const NearbyDroplet& other_nearb
 
 DropletBody3D::DropletBody3D() :
 	m_mesh_instance(nullptr),
-	m_nearby_droplets(),
-	m_nearby_droplet_mutex(),
 	m_is_solid(false),
 	m_pre_solid_collision_mask(0),
 	m_pre_solid_collision_layer(0),
 	m_solid_material(nullptr),
 	m_liquid_material(nullptr),
+	m_mesh_visible(true),
 	m_in_game(false)
 {}
 
@@ -123,68 +73,24 @@ void DropletBody3D::_notification(int what)
 
 // Other Functions
 
-// Adds a nearby droplet to the set.
-bool DropletBody3D::add_nearby_droplet(DropletBody3D* new_droplet_body, float new_distance_squared)
-{
-	bool result = false;
-
-	// Lock for thread safety
-	m_nearby_droplet_mutex.lock();
-
-	// Construct the new droplet
-	NearbyDroplet new_nearby_droplet = NearbyDroplet(new_droplet_body, new_distance_squared);
-	if (new_distance_squared < 0.0)
-	{
-		new_nearby_droplet.distance_squared = get_global_position().distance_squared_to(new_droplet_body->get_global_position());
-	}
-	// Insert the new droplet
-	m_nearby_droplets.insert(new_nearby_droplet);
-	result = true;
+// Deprecated: the fluid server now keeps the nearby droplets of every droplet in one table, which it fills
+// itself (use FluidServer.get_nearby_droplets() to read it), so these only warn and do nothing
 
-	// Unlock for thread safety
-	m_nearby_droplet_mutex.unlock();
-
-	return result;
+bool DropletBody3D::add_nearby_droplet(DropletBody3D* /*new_droplet_body*/, float /*new_distance_squared*/)
+{
+	UtilityFunctions::push_warning("DropletBody3D.add_nearby_droplet() is deprecated and does nothing, the fluid server finds nearby droplets itself.");
+	return false;
 }
 
-// Removes a nearby droplet from the set.
-bool DropletBody3D::remove_nearby_droplet(DropletBody3D* old_droplet_body)
+bool DropletBody3D::remove_nearby_droplet(DropletBody3D* /*old_droplet_body*/)
 {
-	bool result = false;
-
-	// Lock for thread safety
-	m_nearby_droplet_mutex.lock();
-
-	// Search for the nearby droplet that has the same body
-	auto found_nearby_droplet_iter = std::find_if(m_nearby_droplets.begin(), m_nearby_droplets.end(), [old_droplet_body] (NearbyDroplet nearby_droplet)
-	{
-		return nearby_droplet.body == old_droplet_body;
-	});
-
-	// If found, remove it
-	if (found_nearby_droplet_iter != m_nearby_droplets.end())
-	{
-		m_nearby_droplets.erase(found_nearby_droplet_iter);
-		result = true;
-	}
-
-	// Unlock for thread safety
-	m_nearby_droplet_mutex.unlock();
-
-	return result;
+	UtilityFunctions::push_warning("DropletBody3D.remove_nearby_droplet() is deprecated and does nothing, the fluid server finds nearby droplets itself.");
+	return false;
 }
 
-// Clears out the set of nearby droplets.
 void DropletBody3D::clear_nearby_droplets()
 {
-	// Lock for thread safety
-	m_nearby_droplet_mutex.lock();
-
-	// Clear out the whole array
-	m_nearby_droplets.clear();
-
-	// Unlock for thread safety
-	m_nearby_droplet_mutex.unlock();
+	UtilityFunctions::push_warning("DropletBody3D.clear_nearby_droplets() is deprecated and does nothing, the fluid server finds nearby droplets itself.");
 }
 
 // Solidifies/liquifies the droplet
@@ -205,8 +111,8 @@ void DropletBody3D::solidify()
 	set_collision_mask(0);
 	set_collision_layer(0);
 
-	// Set mesh
-	if (UtilityFunctions::is_instance_valid(m_mesh_instance))
+	// Set mesh (skipped when hidden, since nothing would see it)
+	if (m_mesh_visible && UtilityFunctions::is_instance_valid(m_mesh_instance))
 	{
 		m_mesh_instance->set_material_override(m_solid_material);
 	}
@@ -226,8 +132,8 @@ void DropletBody3D::liquefy()
 	set_collision_mask(m_pre_solid_collision_mask);
 	set_collision_layer(m_pre_solid_collision_layer);
 
-	// Set mesh
-	if (UtilityFunctions::is_instance_valid(m_mesh_instance))
+	// Set mesh (skipped when hidden, since nothing would see it)
+	if (m_mesh_visible && UtilityFunctions::is_instance_valid(m_mesh_instance))
 	{
 		m_mesh_instance->set_material_override(m_liquid_material);
 	}
@@ -263,6 +169,27 @@ void DropletBody3D::set_liquid_material(Ref<Material> liquid_material)
 	m_liquid_material = liquid_material;
 }
 
+// Getter and setter for whether the droplet draws its own mesh
+
+bool DropletBody3D::is_mesh_visible() const
+{
+	return m_mesh_visible;
+}
+
+void DropletBody3D::set_mesh_visible(const bool mesh_visible)
+{
+	m_mesh_visible = mesh_visible;
+	// Show/hide the mesh, catching up on any material changes that were skipped while it was hidden
+	if (UtilityFunctions::is_instance_valid(m_mesh_instance))
+	{
+		m_mesh_instance->set_visible(m_mesh_visible);
+		if (m_mesh_visible)
+		{
+			m_mesh_instance->set_material_override(m_is_solid ? m_solid_material : m_liquid_material);
+		}
+	}
+}
+
 
 
 // Notification Methods
@@ -278,6 +205,7 @@ void DropletBody3D::_on_ready()
 	if (UtilityFunctions::is_instance_valid(m_mesh_instance))
 	{
 		m_mesh_instance->set_material_override(m_is_solid ? m_solid_material : m_liquid_material);
+		m_mesh_instance->set_visible(m_mesh_visible);
 	}
 	// Cound not find mesh
 	else
@@ -5,9 +5,7 @@
 #include <godot_cpp/classes/mesh_instance3d.hpp>
 #include <godot_cpp/classes/material.hpp>
 
-#include <set>
 #include <algorithm>
-#include <mutex>
 
 namespace godot
 {
@@ -20,31 +18,9 @@ namespace godot
 		friend class FluidServer;
 
 	private:
-		// A struct holding information about a nearby droplet
-		struct NearbyDroplet
-		{
-			// Properties
-			DropletBody3D* body;
-			float distance_squared;
-			// Constructors
-			NearbyDroplet();
-			NearbyDroplet(DropletBody3D* p_body);
-			NearbyDroplet(DropletBody3D* p_body, float p_distance_squared);
-			// Comparison operators
-			bool operator < (const NearbyDroplet& other_nearby_droplet) const;
-			bool operator > (const NearbyDroplet& other_nearby_droplet) const;
-			bool operator == (const NearbyDroplet& other_nearby_droplet) const;
-			bool operator <= (const NearbyDroplet& other_nearby_droplet) const;
-			bool operator >= (const NearbyDroplet& other_nearby_droplet) const;
-		};
-
 		// The mesh of this droplet
 		MeshInstance3D* m_mesh_instance = nullptr;
 
-		// A set to keep track of nearby droplets
-		std::set<NearbyDroplet> m_nearby_droplets;
-		std::mutex m_nearby_droplet_mutex;
-
 		// Whether the droplet is currently frozen solid
 		bool m_is_solid;
 
@@ -56,6 +32,9 @@ namespace godot
 		Ref<Material> m_solid_material;
 		Ref<Material> m_liquid_material;
 
+		// Whether the droplet draws its own mesh (the fluid server can draw every droplet at once instead)
+		bool m_mesh_visible;
+
 		// Whether currently in-game
 		bool m_in_game;
 
@@ -71,7 +50,8 @@ namespace godot
 		// Overridden functions
 		void _notification(int what);
 
-		// Add or remove droplets from the set of nearby droplets
+		// Deprecated, since the fluid server keeps the nearby droplets in its own table (see
+		// FluidServer::get_nearby_droplets()), so these only warn
 		bool add_nearby_droplet(DropletBody3D* droplet_body, float distance_squared = -1.0);
 		bool remove_nearby_droplet(DropletBody3D* droplet_body);
 		void clear_nearby_droplets();
@@ -88,6 +68,10 @@ namespace godot
 		void set_solid_material(Ref<Material> solid_material);
 		Ref<Material> get_liquid_material() const;
 		void set_liquid_material(Ref<Material> liquid_material);
+
+		// Getter and setter for whether the droplet draws its own mesh
+		bool is_mesh_visible() const;
+		void set_mesh_visible(const bool mesh_visible);
 	
 	private:
 		// Notification methods
@@ -4,9 +4,20 @@
 #include <godot_cpp/variant/utility_functions.hpp>
 #include <godot_cpp/classes/resource_loader.hpp>
 #include <godot_cpp/classes/physics_direct_body_state3d.hpp>
+#include <godot_cpp/classes/world3d.hpp>
+#include <godot_cpp/classes/performance.hpp>
+#include <godot_cpp/core/error_macros.hpp>
 
 using namespace godot;
 
+// The names of the profile stats, as used in get_profile_stats() and the custom monitors
+static const char* PROFILE_STAT_NAMES[] = {
+	"droplet_count", "gather_usec", "pair_loop_usec", "neighbor_build_usec", "scatter_usec", "physics_frame_usec",
+	"async_wait_usec", "snapshot_usec", "multimesh_usec", "solidify_usec", "liquefy_usec", "pairs_tested", "pairs_in_range", "neighbor_inserts",
+	"verlet_rebuilds", "verlet_rebuild_rate", "dormancy_usec", "dormant_droplets", "spatial_sort_usec",
+	"components_usec"
+};
+
 // Needed for exposing stuff to Godot
 void FluidServer::_bind_methods()
 {
@@ -20,10 +31,74 @@ void FluidServer::_bind_methods()
 	ClassDB::bind_method(D_METHOD("set_force_effective_distance", "force_effective_distance"), &FluidServer::set_force_effective_distance);
 	ClassDB::add_property("FluidServer", PropertyInfo(Variant::FLOAT, "force_effective_distance"), "set_force_effective_distance", "get_force_effective_distance");
 
+	// Property: verlet_skin
+	ClassDB::bind_method(D_METHOD("get_verlet_skin"), &FluidServer::get_verlet_skin);
+	ClassDB::bind_method(D_METHOD("set_verlet_skin", "verlet_skin"), &FluidServer::set_verlet_skin);
+	ClassDB::add_property("FluidServer", PropertyInfo(Variant::FLOAT, "verlet_skin"), "set_verlet_skin", "get_verlet_skin");
+
+	// Property: force_accumulation_mode
+	ClassDB::bind_method(D_METHOD("get_force_accumulation_mode"), &FluidServer::get_force_accumulation_mode);
+	ClassDB::bind_method(D_METHOD("set_force_accumulation_mode", "force_accumulation_mode"), &FluidServer::set_force_accumulation_mode);
+	ClassDB::add_property("FluidServer", PropertyInfo(Variant::INT, "force_accumulation_mode", PROPERTY_HINT_ENUM, "Locked,Gather"), "set_force_accumulation_mode", "get_force_accumulation_mode");
+	BIND_ENUM_CONSTANT(FORCE_ACCUMULATION_MODE_LOCKED);
+	BIND_ENUM_CONSTANT(FORCE_ACCUMULATION_MODE_GATHER);
+
+	// Property: kernel_precision
+	ClassDB::bind_method(D_METHOD("get_kernel_precision"), &FluidServer::get_kernel_precision);
+	ClassDB::bind_method(D_METHOD("set_kernel_precision", "kernel_precision"), &FluidServer::set_kernel_precision);
+	ClassDB::add_property("FluidServer", PropertyInfo(Variant::INT, "kernel_precision", PROPERTY_HINT_ENUM, "Exact,Refined,Fast"), "set_kernel_precision", "get_kernel_precision");
+	BIND_ENUM_CONSTANT(KERNEL_PRECISION_EXACT);
+	BIND_ENUM_CONSTANT(KERNEL_PRECISION_REFINED);
+	BIND_ENUM_CONSTANT(KERNEL_PRECISION_FAST);
+
+	// Method: get_kernel_instruction_set
+	ClassDB::bind_method(D_METHOD("get_kernel_instruction_set"), &FluidServer::get_kernel_instruction_set);
+
+	// Property: use_direct_body_state
+	ClassDB::bind_method(D_METHOD("get_use_direct_body_state"), &FluidServer::get_use_direct_body_state);
+	ClassDB::bind_method(D_METHOD("set_use_direct_body_state", "use_direct_body_state"), &FluidServer::set_use_direct_body_state);
+	ClassDB::add_property("FluidServer", PropertyInfo(Variant::BOOL, "use_direct_body_state"), "set_use_direct_body_state", "get_use_direct_body_state");
+
+	// Property: neighbor_graph_mode
+	ClassDB::bind_method(D_METHOD("get_neighbor_graph_mode"), &FluidServer::get_neighbor_graph_mode);
+	ClassDB::bind_method(D_METHOD("set_neighbor_graph_mode", "neighbor_graph_mode"), &FluidServer::set_neighbor_graph_mode);
+	ClassDB::add_property("FluidServer", PropertyInfo(Variant::INT, "neighbor_graph_mode", PROPERTY_HINT_ENUM, "Every Frame,On Demand"), "set_neighbor_graph_mode", "get_neighbor_graph_mode");
+	BIND_ENUM_CONSTANT(NEIGHBOR_GRAPH_MODE_EVERY_FRAME);
+	BIND_ENUM_CONSTANT(NEIGHBOR_GRAPH_MODE_ON_DEMAND);
+
 	// Methods: add_droplet and remove_droplet
 	ClassDB::bind_method(D_METHOD("add_droplet", "droplet_body"), &FluidServer::add_droplet);
 	ClassDB::bind_method(D_METHOD("remove_droplet", "droplet_body"), &FluidServer::remove_droplet);
 
+	// Methods: add_droplet_bodies and remove_droplet_bodies
+	ClassDB::bind_method(D_METHOD("add_droplet_bodies", "droplet_bodies"), &FluidServer::add_droplet_bodies);
+	ClassDB::bind_method(D_METHOD("remove_droplet_bodies", "droplet_bodies"), &FluidServer::remove_droplet_bodies);
+
+	// Methods: add_droplets, remove_droplets, and get_droplet_count
+	ClassDB::bind_method(D_METHOD("add_droplets", "count", "positions", "velocities", "domain"), &FluidServer::add_droplets, DEFVAL(PackedVector3Array()), DEFVAL(0));
+	ClassDB::bind_method(D_METHOD("remove_droplets", "droplet_rids"), &FluidServer::remove_droplets);
+	ClassDB::bind_method(D_METHOD("get_droplet_count"), &FluidServer::get_droplet_count);
+
+	// Methods: get_droplet_domain and set_droplet_domain
+	ClassDB::bind_method(D_METHOD("get_droplet_domain", "droplet_rid"), &FluidServer::get_droplet_domain);
+	ClassDB::bind_method(D_METHOD("set_droplet_domain", "droplet_rid", "domain"), &FluidServer::set_droplet_domain);
+
+	// Property: domain_count
+	ClassDB::bind_method(D_METHOD("get_domain_count"), &FluidServer::get_domain_count);
+	ClassDB::bind_method(D_METHOD("set_domain_count", "domain_count"), &FluidServer::set_domain_count);
+	ClassDB::add_property("FluidServer", PropertyInfo(Variant::INT, "domain_count", PROPERTY_HINT_RANGE, "1,64,1"), "set_domain_count", "get_domain_count");
+
+	// Methods: getters and setters for each domain's settings and the interaction between domains
+	ClassDB::bind_method(D_METHOD("get_domain_force_magnitude", "domain"), &FluidServer::get_domain_force_magnitude);
+	ClassDB::bind_method(D_METHOD("set_domain_force_magnitude", "domain", "force_magnitude"), &FluidServer::set_domain_force_magnitude);
+	ClassDB::bind_method(D_METHOD("get_domain_effective_distance", "domain"), &FluidServer::get_domain_effective_distance);
+	ClassDB::bind_method(D_METHOD("set_domain_effective_distance", "domain", "effective_distance"), &FluidServer::set_domain_effective_distance);
+	ClassDB::bind_method(D_METHOD("get_domain_interaction", "domain_a", "domain_b"), &FluidServer::get_domain_interaction);
+	ClassDB::bind_method(D_METHOD("set_domain_interaction", "domain_a", "domain_b", "interaction"), &FluidServer::set_domain_interaction);
+
+	// Method: get_nearby_droplets
+	ClassDB::bind_method(D_METHOD("get_nearby_droplets", "droplet_body", "sorted"), &FluidServer::get_nearby_droplets, DEFVAL(false));
+
 	// Methods: solidify, liquefy, and is_solid
 	ClassDB::bind_method(D_METHOD("solidify"), &FluidServer::solidify);
 	ClassDB::bind_method(D_METHOD("liquefy"), &FluidServer::liquefy);
@@ -33,6 +108,159 @@ void FluidServer::_bind_methods()
 	ClassDB::bind_method(D_METHOD("get_ice_body_scene_path"), &FluidServer::get_ice_body_scene_path);
 	ClassDB::bind_method(D_METHOD("set_ice_body_scene_path", "ice_body_scene_path"), &FluidServer::set_ice_body_scene_path);
 	ClassDB::add_property("FluidServer", PropertyInfo(Variant::STRING, "ice_body_scene_path", PROPERTY_HINT_FILE), "set_ice_body_scene_path", "get_ice_body_scene_path");
+
+	// Property: server_droplet_radius
+	ClassDB::bind_method(D_METHOD("get_server_droplet_radius"), &FluidServer::get_server_droplet_radius);
+	ClassDB::bind_method(D_METHOD("set_server_droplet_radius", "server_droplet_radius"), &FluidServer::set_server_droplet_radius);
+	ClassDB::add_property("FluidServer", PropertyInfo(Variant::FLOAT, "server_droplet_radius"), "set_server_droplet_radius", "get_server_droplet_radius");
+
+	// Property: server_droplet_mass
+	ClassDB::bind_method(D_METHOD("get_server_droplet_mass"), &FluidServer::get_server_droplet_mass);
+	ClassDB::bind_method(D_METHOD("set_server_droplet_mass", "server_droplet_mass"), &FluidServer::set_server_droplet_mass);
+	ClassDB::add_property("FluidServer", PropertyInfo(Variant::FLOAT, "server_droplet_mass"), "set_server_droplet_mass", "get_server_droplet_mass");
+
+	// Property: server_droplet_friction
+	ClassDB::bind_method(D_METHOD("get_server_droplet_friction"), &FluidServer::get_server_droplet_friction);
+	ClassDB::bind_method(D_METHOD("set_server_droplet_friction", "server_droplet_friction"), &FluidServer::set_server_droplet_friction);
+	ClassDB::add_property("FluidServer", PropertyInfo(Variant::FLOAT, "server_droplet_friction"), "set_server_droplet_friction", "get_server_droplet_friction");
+
+	// Property: server_droplet_bounce
+	ClassDB::bind_method(D_METHOD("get_server_droplet_bounce"), &FluidServer::get_server_droplet_bounce);
+	ClassDB::bind_method(D_METHOD("set_server_droplet_bounce", "server_droplet_bounce"), &FluidServer::set_server_droplet_bounce);
+	ClassDB::add_property("FluidServer", PropertyInfo(Variant::FLOAT, "server_droplet_bounce"), "set_server_droplet_bounce", "get_server_droplet_bounce");
+
+	// Property: server_droplet_collision_layer
+	ClassDB::bind_method(D_METHOD("get_server_droplet_collision_layer"), &FluidServer::get_server_droplet_collision_layer);
+	ClassDB::bind_method(D_METHOD("set_server_droplet_collision_layer", "server_droplet_collision_layer"), &FluidServer::set_server_droplet_collision_layer);
+	ClassDB::add_property("FluidServer", PropertyInfo(Variant::INT, "server_droplet_collision_layer", PROPERTY_HINT_LAYERS_3D_PHYSICS), "set_server_droplet_collision_layer", "get_server_droplet_collision_layer");
+
+	// Property: server_droplet_collision_mask
+	ClassDB::bind_method(D_METHOD("get_server_droplet_collision_mask"), &FluidServer::get_server_droplet_collision_mask);
+	ClassDB::bind_method(D_METHOD("set_server_droplet_collision_mask", "server_droplet_collision_mask"), &FluidServer::set_server_droplet_collision_mask);
+	ClassDB::add_property("FluidServer", PropertyInfo(Variant::INT, "server_droplet_collision_mask", PROPERTY_HINT_LAYERS_3D_PHYSICS), "set_server_droplet_collision_mask", "get_server_droplet_collision_mask");
+
+	// Method: get_snapshot
+	ClassDB::bind_method(D_METHOD("get_snapshot"), &FluidServer::get_snapshot);
+
+	// Property: publish_snapshots
+	ClassDB::bind_method(D_METHOD("get_publish_snapshots"), &FluidServer::get_publish_snapshots);
+	ClassDB::bind_method(D_METHOD("set_publish_snapshots", "publish_snapshots"), &FluidServer::set_publish_snapshots);
+	ClassDB::add_property("FluidServer", PropertyInfo(Variant::BOOL, "publish_snapshots"), "set_publish_snapshots", "get_publish_snapshots");
+
+	// Property: spatial_sort_interval
+	ClassDB::bind_method(D_METHOD("get_spatial_sort_interval"), &FluidServer::get_spatial_sort_interval);
+	ClassDB::bind_method(D_METHOD("set_spatial_sort_interval", "spatial_sort_interval"), &FluidServer::set_spatial_sort_interval);
+	ClassDB::add_property("FluidServer", PropertyInfo(Variant::INT, "spatial_sort_interval", PROPERTY_HINT_RANGE, "0,600,1,or_greater"), "set_spatial_sort_interval", "get_spatial_sort_interval");
+
+	// Property: use_dormancy
+	ClassDB::bind_method(D_METHOD("get_use_dormancy"), &FluidServer::get_use_dormancy);
+	ClassDB::bind_method(D_METHOD("set_use_dormancy", "use_dormancy"), &FluidServer::set_use_dormancy);
+	ClassDB::add_property("FluidServer", PropertyInfo(Variant::BOOL, "use_dormancy"), "set_use_dormancy", "get_use_dormancy");
+
+	// Property: dormancy_velocity_threshold
+	ClassDB::bind_method(D_METHOD("get_dormancy_velocity_threshold"), &FluidServer::get_dormancy_velocity_threshold);
+	ClassDB::bind_method(D_METHOD("set_dormancy_velocity_threshold", "dormancy_velocity_threshold"), &FluidServer::set_dormancy_velocity_threshold);
+	ClassDB::add_property("FluidServer", PropertyInfo(Variant::FLOAT, "dormancy_velocity_threshold"), "set_dormancy_velocity_threshold", "get_dormancy_velocity_threshold");
+
+	// Property: dormancy_ticks
+	ClassDB::bind_method(D_METHOD("get_dormancy_ticks"), &FluidServer::get_dormancy_ticks);
+	ClassDB::bind_method(D_METHOD("set_dormancy_ticks", "dormancy_ticks"), &FluidServer::set_dormancy_ticks);
+	ClassDB::add_property("FluidServer", PropertyInfo(Variant::INT, "dormancy_ticks", PROPERTY_HINT_RANGE, "1,600,1,or_greater"), "set_dormancy_ticks", "get_dormancy_ticks");
+
+	// Property: use_async_forces
+	ClassDB::bind_method(D_METHOD("get_use_async_forces"), &FluidServer::get_use_async_forces);
+	ClassDB::bind_method(D_METHOD("set_use_async_forces", "use_async_forces"), &FluidServer::set_use_async_forces);
+	ClassDB::add_property("FluidServer", PropertyInfo(Variant::BOOL, "use_async_forces"), "set_use_async_forces", "get_use_async_forces");
+
+	// Property: precompute_ice_groups
+	ClassDB::bind_method(D_METHOD("get_precompute_ice_groups"), &FluidServer::get_precompute_ice_groups);
+	ClassDB::bind_method(D_METHOD("set_precompute_ice_groups", "precompute_ice_groups"), &FluidServer::set_precompute_ice_groups);
+	ClassDB::add_property("FluidServer", PropertyInfo(Variant::BOOL, "precompute_ice_groups"), "set_precompute_ice_groups", "get_precompute_ice_groups");
+
+	// Property: thread_count
+	ClassDB::bind_method(D_METHOD("get_thread_count"), &FluidServer::get_thread_count);
+	ClassDB::bind_method(D_METHOD("set_thread_count", "thread_count"), &FluidServer::set_thread_count);
+	ClassDB::add_property("FluidServer", PropertyInfo(Variant::INT, "thread_count", PROPERTY_HINT_RANGE, "0,256,1"), "set_thread_count", "get_thread_count");
+
+	// Property: profiling_enabled
+	ClassDB::bind_method(D_METHOD("get_profiling_enabled"), &FluidServer::get_profiling_enabled);
+	ClassDB::bind_method(D_METHOD("set_profiling_enabled", "profiling_enabled"), &FluidServer::set_profiling_enabled);
+	ClassDB::add_property("FluidServer", PropertyInfo(Variant::BOOL, "profiling_enabled"), "set_profiling_enabled", "get_profiling_enabled");
+
+	// Methods: get_profile_stats and get_profile_stat
+	ClassDB::bind_method(D_METHOD("get_profile_stats"), &FluidServer::get_profile_stats);
+	ClassDB::bind_method(D_METHOD("get_profile_stat", "stat_name"), &FluidServer::get_profile_stat);
+
+	// Property: use_multimesh
+	ClassDB::bind_method(D_METHOD("get_use_multimesh"), &FluidServer::get_use_multimesh);
+	ClassDB::bind_method(D_METHOD("set_use_multimesh", "use_multimesh"), &FluidServer::set_use_multimesh);
+	ClassDB::add_property("FluidServer", PropertyInfo(Variant::BOOL, "use_multimesh"), "set_use_multimesh", "get_use_multimesh");
+
+	// Property: droplet_mesh
+	ClassDB::bind_method(D_METHOD("get_droplet_mesh"), &FluidServer::get_droplet_mesh);
+	ClassDB::bind_method(D_METHOD("set_droplet_mesh", "droplet_mesh"), &FluidServer::set_droplet_mesh);
+	ClassDB::add_property("FluidServer", PropertyInfo(Variant::OBJECT, "droplet_mesh", PROPERTY_HINT_RESOURCE_TYPE, "Mesh"), "set_droplet_mesh", "get_droplet_mesh");
+
+	// Property: droplet_material
+	ClassDB::bind_method(D_METHOD("get_droplet_material"), &FluidServer::get_droplet_material);
+	ClassDB::bind_method(D_METHOD("set_droplet_material", "droplet_material"), &FluidServer::set_droplet_material);
+	ClassDB::add_property("FluidServer", PropertyInfo(Variant::OBJECT, "droplet_material", PROPERTY_HINT_RESOURCE_TYPE, "Material"), "set_droplet_material", "get_droplet_material");
+}
+
+
+
+// DropletArrays Methods
+
+// Gets the number of droplets
+size_t FluidServer::DropletArrays::size() const
+{
+	return body.size();
+}
+
+// Appends a droplet to the end of the arrays and returns its index
+uint32_t FluidServer::DropletArrays::push_back(DropletBody3D* p_body, const RID& p_rid)
+{
+	body.push_back(p_body);
+	rid.push_back(p_rid);
+	quiet_ticks.push_back(0);
+	return body.size() - 1;
+}
+
+// Makes room for a number of droplets, so that adding them does not reallocate
+void FluidServer::DropletArrays::reserve(size_t capacity)
+{
+	body.reserve(capacity);
+	rid.reserve(capacity);
+	quiet_ticks.reserve(capacity);
+}
+
+// Moves every droplet to where an order says it belongs (the old index of the droplet at each index)
+void FluidServer::DropletArrays::permute(const std::vector<uint32_t>& order)
+{
+	std::vector<DropletBody3D*> permuted_body(order.size());
+	std::vector<RID> permuted_rid(order.size());
+	std::vector<uint32_t> permuted_quiet_ticks(order.size());
+	for (size_t i = 0; i < order.size(); ++i)
+	{
+		permuted_body[i] = body[order[i]];
+		permuted_rid[i] = rid[order[i]];
+		permuted_quiet_ticks[i] = quiet_ticks[order[i]];
+	}
+	body.swap(permuted_body);
+	rid.swap(permuted_rid);
+	quiet_ticks.swap(permuted_quiet_ticks);
+}
+
+// Removes a droplet by moving the last droplet into its place (so only the last droplet's index changes)
+void FluidServer::DropletArrays::swap_remove(uint32_t index)
+{
+	size_t last = body.size() - 1;
+	body[index] = body[last];
+	rid[index] = rid[last];
+	quiet_ticks[index] = quiet_ticks[last];
+	body.pop_back();
+	rid.pop_back();
+	quiet_ticks.pop_back();
 }
 
 
@@ -40,14 +268,45 @@ void FluidServer::_bind_methods()
 // Constructor and Destructor
 
 FluidServer::FluidServer() :
-	m_droplet_records(),
-	m_force_magnitude(25.0),
-	m_force_effective_distance(0.5),
-	m_force_effective_distance_squared(0.25),
+	m_droplets(),
+	m_droplet_indices(),
+	m_solver(),
+	m_neighbor_table_valid(false),
+	m_precompute_ice_groups(false),
+	m_components_valid(false),
+	m_neighbor_graph_mode(NEIGHBOR_GRAPH_MODE_ON_DEMAND),
+	m_spatial_sort_interval(120),
+	m_frames_since_spatial_sort(0),
+	m_use_dormancy(false),
+	m_dormancy_velocity_threshold(0.05),
+	m_dormancy_ticks(60),
+	m_next_dormant_cluster(0),
+	m_use_async_forces(false),
+	m_async_forces_pending(false),
+	m_publish_snapshots(false),
+	m_snapshot_buffers(),
+	m_published_snapshot(),
+	m_snapshot_frame(0),
+	m_use_direct_body_state(true),
 	m_is_solid(false),
 	m_ice_bodies(),
 	m_ice_body_scene_path(),
 	m_ice_body_scene(),
+	m_server_droplet_radius(0.167),
+	m_server_droplet_mass(4.0),
+	m_server_droplet_friction(0.05),
+	m_server_droplet_bounce(0.3),
+	m_server_droplet_collision_layer(1),
+	m_server_droplet_collision_mask(1),
+	m_server_droplet_shape(),
+	m_use_multimesh(false),
+	m_droplet_mesh(),
+	m_droplet_material(),
+	m_multimesh_instance(nullptr),
+	m_multimesh(),
+	m_multimesh_buffer(),
+	m_profile_stats(),
+	m_profile_monitors_added(false),
 	m_in_game(false),
 	m_physics_server(nullptr)
 {}
@@ -67,8 +326,24 @@ void FluidServer::_notification(int what)
 		// Handle when the node enters the scene tree for the first time.
 		case NOTIFICATION_READY:
 			_on_ready();
+			set_process(true);
 			set_physics_process(true);
 			break;
+		// Handle when the node enters/exits the scene tree.
+		case NOTIFICATION_ENTER_TREE:
+			add_profile_monitors();
+			break;
+		case NOTIFICATION_EXIT_TREE:
+			remove_profile_monitors();
+			break;
+		// Handle when the node is about to be deleted.
+		case NOTIFICATION_PREDELETE:
+			_on_predelete();
+			break;
+		// Handle the process frame.
+		case NOTIFICATION_PROCESS:
+			_on_process(get_process_delta_time());
+			break;
 		// Handle the physics frame.
 		case NOTIFICATION_PHYSICS_PROCESS:
 			_on_physics_process(get_physics_process_delta_time());
@@ -84,119 +359,492 @@ void FluidServer::_notification(int what)
 
 bool FluidServer::add_droplet(DropletBody3D* new_droplet_body)
 {
-	// See if it already exists in the dynamic array
-	auto found_location = std::find_if(m_droplet_records.begin(), m_droplet_records.end(),
-		[new_droplet_body] (DropletRecord& droplet_record)
+	// Add it, unless it has already been added
+	if (!insert_droplet_body(new_droplet_body))
+		return false;
+	m_neighbor_table_valid = false;
+	// If the fluid is currently solid, make sure the droplet is solid also
+	if (m_is_solid)
+	{
+		// Create the ice body
+		IceBody3D* ice_body = create_ice_body();
+		// Add the droplet to it
+		ice_body->add_droplet(new_droplet_body);
+		// Stop processing on the droplet
+		new_droplet_body->solidify();
+	}
+	return true;
+}
+
+bool FluidServer::remove_droplet(DropletBody3D* old_droplet_body)
+{
+	// Take it out, unless it was never added
+	if (!erase_droplet_body(old_droplet_body))
+		return false;
+	// The neighbor table refers to droplets by index, so it is out of date now
+	m_solver.clear_neighbor_table();
+	m_neighbor_table_valid = false;
+	return true;
+}
+
+// Adds/removes many droplets at once, returning how many were actually added/removed
+
+int32_t FluidServer::add_droplet_bodies(const TypedArray<DropletBody3D>& new_droplet_bodies)
+{
+	// The solver cannot be touched while it is computing forces in the background
+	m_solver.wait_for_step();
+	// Make room for all of them up front
+	m_droplets.reserve(m_droplets.size() + new_droplet_bodies.size());
+	m_solver.reserve(m_droplets.size() + new_droplet_bodies.size());
+	m_droplet_indices.reserve(m_droplets.size() + new_droplet_bodies.size());
+	// Add each one that has not already been added (including earlier in this same batch)
+	std::vector<DropletBody3D*> added_droplet_bodies;
+	added_droplet_bodies.reserve(new_droplet_bodies.size());
+	for (int64_t i = 0; i < new_droplet_bodies.size(); ++i)
 	{
-		return droplet_record.body == new_droplet_body;
-	});
-	// Not found, so add it
-	if (found_location == m_droplet_records.end())
+		DropletBody3D* new_droplet_body = Object::cast_to<DropletBody3D>(new_droplet_bodies[i]);
+		if (new_droplet_body != nullptr && insert_droplet_body(new_droplet_body))
+		{
+			added_droplet_bodies.push_back(new_droplet_body);
+		}
+	}
+	if (added_droplet_bodies.empty())
+		return 0;
+	m_neighbor_table_valid = false;
+	// If the fluid is currently solid, freeze the new droplets together into one ice body at their center
+	if (m_is_solid)
 	{
-		// Add it as a child
-		if (UtilityFunctions::is_instance_valid(new_droplet_body->get_parent()))
+		// Sum up important values
+		float ice_mass = 0.0;
+		Vector3 center = Vector3(0.0, 0.0, 0.0);
+		Vector3 ice_linear_momentum = Vector3(0.0, 0.0, 0.0);
+		for (DropletBody3D* droplet_body : added_droplet_bodies)
 		{
-			new_droplet_body->reparent(this, true);
-			new_droplet_body->set_owner(get_owner());
+			float droplet_mass = droplet_body->get_mass();
+			ice_mass += droplet_mass;
+			center += droplet_mass * droplet_body->get_global_position();
+			ice_linear_momentum += droplet_mass * droplet_body->get_linear_velocity();
 		}
-		else
+		center = center / ice_mass;
+		// Create the ice body and add the droplets to it
+		IceBody3D* ice_body = create_ice_body();
+		ice_body->set_global_position(center);
+		for (DropletBody3D* droplet_body : added_droplet_bodies)
 		{
-			add_child(new_droplet_body);
-			new_droplet_body->set_owner(get_owner());
+			ice_body->quick_add_droplet(droplet_body);
+			droplet_body->solidify();
 		}
-		// Add it to the dynamic array
-		DropletRecord new_droplet_record = DropletRecord();
-		new_droplet_record.body = new_droplet_body;
-		new_droplet_record.position = Vec3(new_droplet_body->get_global_position());
-		new_droplet_record.force = Vec3::ZERO;
-		m_droplet_records.push_back(new_droplet_record);
-		// If the fluid is currently solid, make sure the droplet is solid also
-		if (m_is_solid)
+		ice_body->set_mass(ice_mass);
+		ice_body->set_linear_velocity(ice_linear_momentum / ice_mass);
+	}
+	return added_droplet_bodies.size();
+}
+
+int32_t FluidServer::remove_droplet_bodies(const TypedArray<DropletBody3D>& old_droplet_bodies)
+{
+	int32_t removed_count = 0;
+	for (int64_t i = 0; i < old_droplet_bodies.size(); ++i)
+	{
+		DropletBody3D* old_droplet_body = Object::cast_to<DropletBody3D>(old_droplet_bodies[i]);
+		if (old_droplet_body != nullptr && erase_droplet_body(old_droplet_body))
 		{
-			// Create the ice body
-			IceBody3D* ice_body = create_ice_body();
-			// Add the droplet to it
-			ice_body->add_droplet(new_droplet_body);
-			// Stop processing on the droplet
-			new_droplet_body->solidify();
+			++removed_count;
 		}
-		return true;
 	}
-	// Found, so don't add it
-	else
+	// The neighbor table refers to droplets by index, so it is out of date now (only needs clearing once)
+	if (removed_count > 0)
 	{
-		return false;
+		m_solver.clear_neighbor_table();
+		m_neighbor_table_valid = false;
 	}
+	return removed_count;
 }
 
-bool FluidServer::remove_droplet(DropletBody3D* old_droplet_body)
+// Adds/removes droplets that only exist in the physics server
+
+TypedArray<RID> FluidServer::add_droplets(const int32_t count, const PackedVector3Array& positions, const PackedVector3Array& velocities, const int32_t domain)
 {
-	// Try to find it
-	auto found_location = std::find_if(m_droplet_records.begin(), m_droplet_records.end(),
-		[&old_droplet_body] (DropletRecord& droplet_record)
+	TypedArray<RID> new_droplet_rids;
+	// Bodies can only be put into a physics space while running in the scene tree
+	if (!m_in_game || !is_inside_tree())
 	{
-		return droplet_record.body == old_droplet_body;
-	});
-	// Couldn't find it
-	if (found_location == m_droplet_records.end())
+		UtilityFunctions::printerr("Droplets can only be added to ", this, " while it is running in the scene tree");
+		return new_droplet_rids;
+	}
+	// Need a position, and optionally a velocity, for each droplet
+	if (count < 0 || positions.size() < count || (!velocities.is_empty() && velocities.size() < count))
 	{
-		return false;
+		UtilityFunctions::printerr("Expected a position (and a velocity, if any are given) for each of the ", count, " droplets");
+		return new_droplet_rids;
 	}
-	// Found it, so remove it
-	else
+	if (!is_valid_domain(domain))
+		return new_droplet_rids;
+	// Without nodes, there is nothing else to draw them
+	if (m_multimesh_instance == nullptr)
+	{
+		UtilityFunctions::push_warning("Droplets added with add_droplets() are only drawn when use_multimesh is on");
+	}
+	// All of the droplets share one sphere shape
+	if (!m_server_droplet_shape.is_valid())
+	{
+		m_server_droplet_shape = m_physics_server->sphere_shape_create();
+		m_physics_server->shape_set_data(m_server_droplet_shape, m_server_droplet_radius);
+	}
+	RID space = get_world_3d()->get_space();
+	// The solver cannot be touched while it is computing forces in the background
+	m_solver.wait_for_step();
+	// Make room for all of them up front
+	m_droplets.reserve(m_droplets.size() + count);
+	m_solver.reserve(m_droplets.size() + count);
+	m_droplet_indices.reserve(m_droplets.size() + count);
+	// Create a body for each droplet
+	for (int32_t i = 0; i < count; ++i)
+	{
+		RID droplet_rid = m_physics_server->body_create();
+		// Set it up like the droplet scene (rotation is locked, and it never sleeps)
+		m_physics_server->body_set_mode(droplet_rid, PhysicsServer3D::BODY_MODE_RIGID_LINEAR);
+		m_physics_server->body_add_shape(droplet_rid, m_server_droplet_shape);
+		m_physics_server->body_set_param(droplet_rid, PhysicsServer3D::BODY_PARAM_MASS, m_server_droplet_mass);
+		m_physics_server->body_set_param(droplet_rid, PhysicsServer3D::BODY_PARAM_FRICTION, m_server_droplet_friction);
+		m_physics_server->body_set_param(droplet_rid, PhysicsServer3D::BODY_PARAM_BOUNCE, m_server_droplet_bounce);
+		m_physics_server->body_set_collision_layer(droplet_rid, m_server_droplet_collision_layer);
+		m_physics_server->body_set_collision_mask(droplet_rid, m_server_droplet_collision_mask);
+		m_physics_server->body_set_state(droplet_rid, PhysicsServer3D::BODY_STATE_CAN_SLEEP, false);
+		m_physics_server->body_set_state(droplet_rid, PhysicsServer3D::BODY_STATE_TRANSFORM, Transform3D(Basis(), positions[i]));
+		if (!velocities.is_empty())
+		{
+			m_physics_server->body_set_state(droplet_rid, PhysicsServer3D::BODY_STATE_LINEAR_VELOCITY, velocities[i]);
+		}
+		// Put it in the world last, once it is fully set up
+		m_physics_server->body_set_space(droplet_rid, space);
+		// Add it to the droplet arrays
+		m_droplet_indices[droplet_rid.get_id()] = m_droplets.push_back(nullptr, droplet_rid);
+		m_solver.add_point(to_vec3(positions[i]), domain);
+		new_droplet_rids.push_back(droplet_rid);
+	}
+	m_neighbor_table_valid = false;
+	// If the fluid is currently solid, freeze the new droplets together into one ice body at their center
+	if (m_is_solid && count > 0)
+	{
+		Vector3 center = Vector3(0.0, 0.0, 0.0);
+		Vector3 linear_velocity = Vector3(0.0, 0.0, 0.0);
+		for (int32_t i = 0; i < count; ++i)
+		{
+			center += positions[i];
+			if (!velocities.is_empty())
+				linear_velocity += velocities[i];
+		}
+		center = center / count;
+		linear_velocity = linear_velocity / count;
+		IceBody3D* ice_body = create_ice_body();
+		ice_body->set_global_position(center);
+		for (int32_t i = 0; i < count; ++i)
+		{
+			RID droplet_rid = new_droplet_rids[i];
+			ice_body->quick_add_droplet_rid(droplet_rid, Transform3D(Basis(), positions[i]));
+			solidify_server_droplet(droplet_rid);
+		}
+		ice_body->set_mass(m_server_droplet_mass * count);
+		ice_body->set_linear_velocity(linear_velocity);
+	}
+	return new_droplet_rids;
+}
+
+int32_t FluidServer::remove_droplets(const TypedArray<RID>& droplet_rids)
+{
+	// The solver cannot be touched while it is computing forces in the background
+	m_solver.wait_for_step();
+	int32_t removed_count = 0;
+	for (int64_t i = 0; i < droplet_rids.size(); ++i)
 	{
-		m_droplet_records.erase(found_location);
-		// If currently in a solid state...
+		RID droplet_rid = droplet_rids[i];
+		// Skip droplets that are not in this server, or that have nodes (those are removed with remove_droplet())
+		auto found_index_iter = m_droplet_indices.find(droplet_rid.get_id());
+		if (found_index_iter == m_droplet_indices.end() || m_droplets.body[found_index_iter->second] != nullptr)
+			continue;
+		// Move the last droplet into the removed droplet's place
+		uint32_t old_index = found_index_iter->second;
+		m_droplet_indices.erase(found_index_iter);
+		m_droplets.swap_remove(old_index);
+		m_solver.swap_remove_point(old_index);
+		if (old_index < m_droplets.size())
+		{
+			m_droplet_indices[m_droplets.rid[old_index].get_id()] = old_index;
+		}
+		// Take it out of its ice body (with the mass it was given when it was added, since the setting may have changed
+		// since), freeing the ice body if that was its last droplet
 		if (m_is_solid)
 		{
-			// Remove it from its ice body
-			for (IceBody3D* ice_body : m_ice_bodies)
-			{
-				ice_body->remove_droplet(old_droplet_body);
-			}
-			// Inform nearby droplets that it is gone
-			for (DropletBody3D::NearbyDroplet nearby_droplet : old_droplet_body->m_nearby_droplets)
+			float droplet_mass = m_physics_server->body_get_param(droplet_rid, PhysicsServer3D::BODY_PARAM_MASS);
+			for (auto ice_body_iter = m_ice_bodies.begin(); ice_body_iter != m_ice_bodies.end(); ++ice_body_iter)
 			{
-				nearby_droplet.body->remove_nearby_droplet(old_droplet_body);
+				IceBody3D* ice_body = *ice_body_iter;
+				if (ice_body->remove_droplet_rid(droplet_rid, droplet_mass))
+				{
+					if (ice_body->m_droplet_collisions.empty())
+					{
+						ice_body->queue_free();
+						m_ice_bodies.erase(ice_body_iter);
+					}
+					break;
+				}
 			}
-			// Reparent it to the fluid server
-			old_droplet_body->reparent(this, true);
-			old_droplet_body->set_owner(get_owner());
-			// Start processing on it again
-			old_droplet_body->liquefy();
 		}
-		// The removed droplet shouldn't have any nearby droplets anymore
-		old_droplet_body->clear_nearby_droplets();
-		return true;
+		// Nothing else refers to the body, so free it
+		m_physics_server->free_rid(droplet_rid);
+		++removed_count;
+	}
+	// The neighbor table refers to droplets by index, so it is out of date now
+	if (removed_count > 0)
+	{
+		m_solver.clear_neighbor_table();
+		m_neighbor_table_valid = false;
+	}
+	return removed_count;
+}
+
+// Gets the number of droplets in the server, with or without nodes
+int32_t FluidServer::get_droplet_count() const
+{
+	return m_droplets.size();
+}
+
+// Gets/sets which domain a droplet belongs to, by its body's RID (droplets start out in domain 0, unless added to
+// another one with add_droplets())
+
+int32_t FluidServer::get_droplet_domain(const RID& droplet_rid) const
+{
+	auto found_index_iter = m_droplet_indices.find(droplet_rid.get_id());
+	if (found_index_iter == m_droplet_indices.end())
+		return -1;
+	return m_solver.get_domain(found_index_iter->second);
+}
+
+bool FluidServer::set_droplet_domain(const RID& droplet_rid, const int32_t domain)
+{
+	auto found_index_iter = m_droplet_indices.find(droplet_rid.get_id());
+	if (found_index_iter == m_droplet_indices.end() || !is_valid_domain(domain))
+		return false;
+	m_solver.wait_for_step();
+	m_solver.set_domain(found_index_iter->second, domain);
+	// Which droplets count as nearby depends on their domains
+	m_neighbor_table_valid = false;
+	return true;
+}
+
+// Gets the droplets near a droplet, optionally sorted from nearest to farthest
+TypedArray<DropletBody3D> FluidServer::get_nearby_droplets(DropletBody3D* droplet_body, const bool sorted)
+{
+	TypedArray<DropletBody3D> nearby_droplets;
+	ERR_FAIL_NULL_V(droplet_body, nearby_droplets);
+	// Make sure the neighbor table is up to date
+	update_neighbor_table();
+	// Droplets that are not in this server have no neighbors
+	auto found_index_iter = m_droplet_indices.find(droplet_body->get_rid().get_id());
+	if (found_index_iter == m_droplet_indices.end() || found_index_iter->second >= m_solver.get_neighbor_table().get_point_count())
+		return nearby_droplets;
+	uint32_t droplet_index = found_index_iter->second;
+	const NeighborTable& neighbor_table = m_solver.get_neighbor_table();
+	// Only sort when asked to
+	if (sorted)
+	{
+		std::vector<uint32_t> sorted_neighbors;
+		neighbor_table.get_sorted_neighbors(droplet_index, sorted_neighbors);
+		for (uint32_t neighbor_index : sorted_neighbors)
+		{
+			if (m_droplets.body[neighbor_index] != nullptr)
+				nearby_droplets.push_back(m_droplets.body[neighbor_index]);
+		}
+	}
+	else
+	{
+		const uint32_t* neighbors = neighbor_table.get_neighbors(droplet_index);
+		for (uint32_t i = 0; i < neighbor_table.get_neighbor_count(droplet_index); ++i)
+		{
+			if (m_droplets.body[neighbors[i]] != nullptr)
+				nearby_droplets.push_back(m_droplets.body[neighbors[i]]);
+		}
 	}
+	return nearby_droplets;
+}
+
+// Gets the latest snapshot published by the physics frame (safe to call from any thread, since the snapshot is
+// never written to again once published, and the packed arrays are copied on write if a buffer is reused)
+Dictionary FluidServer::get_snapshot() const
+{
+	Dictionary snapshot;
+	std::shared_ptr<const DropletSnapshot> published_snapshot = std::atomic_load(&m_published_snapshot);
+	if (published_snapshot == nullptr)
+		return snapshot;
+	snapshot["frame"] = (int64_t)published_snapshot->frame;
+	snapshot["droplet_count"] = (int64_t)published_snapshot->droplet_ids.size();
+	snapshot["droplet_ids"] = published_snapshot->droplet_ids;
+	snapshot["positions"] = published_snapshot->positions;
+	snapshot["velocities"] = published_snapshot->velocities;
+	snapshot["neighbor_counts"] = published_snapshot->neighbor_counts;
+	return snapshot;
 }
 
 // Getters and setters for force magnitude
 
 float FluidServer::get_force_magnitude() const
 {
-	return m_force_magnitude;
+	return m_solver.get_force_magnitude();
 }
 
 void FluidServer::set_force_magnitude(const float force_magnitude)
 {
-	m_force_magnitude = force_magnitude;
+	m_solver.wait_for_step();
+	m_solver.set_force_magnitude(force_magnitude);
 }
 
 // Getters and setters for force effective distance
 
 float FluidServer::get_force_effective_distance() const
 {
-	return m_force_effective_distance;
+	return m_solver.get_effective_distance();
 }
 
 void FluidServer::set_force_effective_distance(const float force_effective_distance)
 {
-	if (force_effective_distance < 0)
-		m_force_effective_distance = 0;
-	else
-		m_force_effective_distance = force_effective_distance;
-	m_force_effective_distance_squared = m_force_effective_distance * m_force_effective_distance;
+	m_solver.wait_for_step();
+	m_solver.set_effective_distance(force_effective_distance);
+}
+
+// Getters and setters for domain count
+
+int32_t FluidServer::get_domain_count() const
+{
+	return m_solver.get_domain_count();
+}
+
+void FluidServer::set_domain_count(const int32_t domain_count)
+{
+	m_solver.wait_for_step();
+	m_solver.set_domain_count(domain_count < 1 ? 1 : domain_count);
+	m_neighbor_table_valid = false;
+}
+
+// Getters and setters for each domain's settings (domain 0's are the same as force_magnitude and
+// force_effective_distance)
+
+float FluidServer::get_domain_force_magnitude(const int32_t domain) const
+{
+	if (!is_valid_domain(domain))
+		return 0.0;
+	return m_solver.get_domain_force_magnitude(domain);
+}
+
+void FluidServer::set_domain_force_magnitude(const int32_t domain, const float force_magnitude)
+{
+	if (!is_valid_domain(domain))
+		return;
+	m_solver.wait_for_step();
+	m_solver.set_domain_force_magnitude(domain, force_magnitude);
+}
+
+float FluidServer::get_domain_effective_distance(const int32_t domain) const
+{
+	if (!is_valid_domain(domain))
+		return 0.0;
+	return m_solver.get_domain_effective_distance(domain);
+}
+
+void FluidServer::set_domain_effective_distance(const int32_t domain, const float effective_distance)
+{
+	if (!is_valid_domain(domain))
+		return;
+	m_solver.wait_for_step();
+	m_solver.set_domain_effective_distance(domain, effective_distance);
+	m_neighbor_table_valid = false;
+}
+
+// Getters and setters for how strongly two domains attract each other, as a fraction of the average of their force
+// magnitudes (0 for different domains by default, which keeps them apart entirely)
+
+float FluidServer::get_domain_interaction(const int32_t domain_a, const int32_t domain_b) const
+{
+	if (!is_valid_domain(domain_a) || !is_valid_domain(domain_b))
+		return 0.0;
+	return m_solver.get_domain_interaction(domain_a, domain_b);
+}
+
+void FluidServer::set_domain_interaction(const int32_t domain_a, const int32_t domain_b, const float interaction)
+{
+	if (!is_valid_domain(domain_a) || !is_valid_domain(domain_b))
+		return;
+	m_solver.wait_for_step();
+	m_solver.set_domain_interaction(domain_a, domain_b, interaction);
+	m_neighbor_table_valid = false;
+}
+
+// Getters and setters for verlet skin
+
+float FluidServer::get_verlet_skin() const
+{
+	return m_solver.get_verlet_skin();
+}
+
+void FluidServer::set_verlet_skin(const float verlet_skin)
+{
+	m_solver.wait_for_step();
+	m_solver.set_verlet_skin(verlet_skin);
+}
+
+// Getters and setters for force accumulation mode
+
+FluidServer::ForceAccumulationMode FluidServer::get_force_accumulation_mode() const
+{
+	return static_cast<ForceAccumulationMode>(m_solver.get_accumulation_mode());
+}
+
+void FluidServer::set_force_accumulation_mode(const ForceAccumulationMode force_accumulation_mode)
+{
+	m_solver.wait_for_step();
+	m_solver.set_accumulation_mode(static_cast<CohesionAccumulationMode>(force_accumulation_mode));
+}
+
+// Getters and setters for kernel precision
+
+FluidServer::KernelPrecision FluidServer::get_kernel_precision() const
+{
+	return static_cast<KernelPrecision>(m_solver.get_kernel_precision());
+}
+
+void FluidServer::set_kernel_precision(const KernelPrecision kernel_precision)
+{
+	m_solver.wait_for_step();
+	m_solver.set_kernel_precision(static_cast<CohesionKernelPrecision>(kernel_precision));
+}
+
+// Getter for the instruction set the vectorized kernel is using on this CPU
+String FluidServer::get_kernel_instruction_set() const
+{
+	return String(cohesion_kernel_get_isa_name(cohesion_kernel_get_isa()));
+}
+
+// Getters and setters for use direct body state
+
+bool FluidServer::get_use_direct_body_state() const
+{
+	return m_use_direct_body_state;
+}
+
+void FluidServer::set_use_direct_body_state(const bool use_direct_body_state)
+{
+	m_use_direct_body_state = use_direct_body_state;
+}
+
+// Getters and setters for neighbor graph mode
+
+FluidServer::NeighborGraphMode FluidServer::get_neighbor_graph_mode() const
+{
+	return m_neighbor_graph_mode;
+}
+
+void FluidServer::set_neighbor_graph_mode(const NeighborGraphMode neighbor_graph_mode)
+{
+	m_neighbor_graph_mode = neighbor_graph_mode;
 }
 
 // Solidifies/liquifies the droplets in this server
@@ -206,39 +854,44 @@ void FluidServer::solidify()
 	// Return early if already solid
 	if (m_is_solid)
 		return;
+	std::chrono::steady_clock::time_point solidify_start = std::chrono::steady_clock::now();
 
-	// Create the array of droplet sets and their centers
-	std::vector<DropletSet> droplet_sets;
-	std::vector<Vector3> droplet_set_centers;
+	// Make sure the neighbor table is up to date (this also waits for any forces being computed in the background,
+	// which are thrown away since the droplets are about to freeze)
+	update_neighbor_table();
+	m_async_forces_pending = false;
+	// Frozen droplets are handled by their ice bodies, and melt awake
+	wake_all_droplets();
 
-	// First loop to group droplets together into a set
-	for (DropletRecord& droplet_record : m_droplet_records)
+	// Get where each droplet is right now, and copy it into the solver so that the centers of the groups are found
+	// from the same positions as the droplets' offsets from them (the solver's copy is from the start of the frame, or
+	// the one before)
+	std::vector<Vector3> droplet_positions(m_droplets.size());
+	for (uint32_t i = 0; i < m_droplets.size(); ++i)
 	{
-		// Test if it's already in a set
-		auto found_set_iter = std::find_if(droplet_sets.begin(), droplet_sets.end(),
-			[&droplet_record] (DropletSet& droplet_set)
-		{
-			return droplet_set.find(droplet_record.body) != droplet_set.end();
-		});
-		// Not yet in a set...
-		if (found_set_iter == droplet_sets.end())
-		{
-			// Add it to a new set (and its nearby droplets recursively)
-			DropletSet new_droplet_set = DropletSet();
-			Vector3 new_droplet_set_center = Vector3(0.0, 0.0, 0.0);
-			add_droplet_to_set(droplet_record.body, new_droplet_set, new_droplet_set_center);
-			// Add that set to the dynamic array of sets
-			droplet_sets.push_back(new_droplet_set);
-			droplet_set_centers.push_back(new_droplet_set_center);
-		}
+		if (m_droplets.body[i] != nullptr)
+			droplet_positions[i] = m_droplets.body[i]->get_global_position();
+		else
+			droplet_positions[i] = m_physics_server->body_get_direct_state(m_droplets.rid[i])->get_transform().origin;
+		m_solver.set_position(i, to_vec3(droplet_positions[i]));
 	}
 
-	// Second loop to create an ice block for each droplet set
-	for (int i = 0; i < droplet_sets.size(); ++i)
+	// Group the droplets that are connected through nearby droplets (unless they were already grouped along with
+	// the table), and find the center of each group
+	if (!m_components_valid)
+		m_solver.build_components();
+	m_components_valid = true;
+	const ConnectedComponents& droplet_components = m_solver.get_components();
+	std::vector<Vec3> component_centers;
+	m_solver.compute_component_centers(component_centers);
+
+	// Create an ice block for each group
+	for (uint32_t component = 0; component < droplet_components.get_component_count(); ++component)
 	{
-		// Get the current set and center
-		DropletSet& droplet_set = droplet_sets[i];
-		Vector3& center = droplet_set_centers[i];
+		// Get the current group and center
+		const uint32_t* component_droplets = droplet_components.get_members(component);
+		uint32_t component_size = droplet_components.get_member_count(component);
+		Vector3 center = to_vector3(component_centers[component]);
 		// Create a new ice body
 		IceBody3D* ice_body = create_ice_body();
 		ice_body->set_global_position(center);
@@ -246,20 +899,41 @@ void FluidServer::solidify()
 		float ice_mass = 0.0;
 		Vector3 ice_linear_momentum = Vector3(0.0, 0.0, 0.0);
 		Vector3 ice_angular_momentum = Vector3(0.0, 0.0, 0.0);
-		for (DropletBody3D* droplet_body : droplet_set)
+		for (uint32_t i = 0; i < component_size; ++i)
 		{
+			uint32_t droplet_index = component_droplets[i];
+			DropletBody3D* droplet_body = m_droplets.body[droplet_index];
 			// Sum values
-			float droplet_mass = droplet_body->get_mass();
-			Vector3 droplet_velocity = droplet_body->get_linear_velocity();
-			Vector3 droplet_offset = droplet_body->get_global_position() - center;
+			float droplet_mass;
+			Vector3 droplet_velocity;
+			Vector3 droplet_position = droplet_positions[droplet_index];
+			if (droplet_body != nullptr)
+			{
+				droplet_mass = droplet_body->get_mass();
+				droplet_velocity = droplet_body->get_linear_velocity();
+			}
+			else
+			{
+				droplet_mass = m_physics_server->body_get_param(m_droplets.rid[droplet_index], PhysicsServer3D::BODY_PARAM_MASS);
+				droplet_velocity = m_physics_server->body_get_direct_state(m_droplets.rid[droplet_index])->get_linear_velocity();
+			}
+			Vector3 droplet_offset = droplet_position - center;
 			Vector3 droplet_momentum = droplet_mass * droplet_velocity;
 			ice_mass += droplet_mass;
 			ice_linear_momentum += droplet_momentum;
 			// TODO: double check that this calculation is correct (for use with inertia tensor)
 			ice_angular_momentum += droplet_offset.cross(droplet_momentum);
 			// Add the droplet and freeze it
-			ice_body->quick_add_droplet(droplet_body);
-			droplet_body->solidify();
+			if (droplet_body != nullptr)
+			{
+				ice_body->quick_add_droplet(droplet_body);
+				droplet_body->solidify();
+			}
+			else
+			{
+				ice_body->quick_add_droplet_rid(m_droplets.rid[droplet_index], Transform3D(Basis(), droplet_position));
+				solidify_server_droplet(m_droplets.rid[droplet_index]);
+			}
 		}
 		// Set physics properties of the ice body
 		ice_body->set_mass(ice_mass);
@@ -270,6 +944,7 @@ void FluidServer::solidify()
 
 	// Mark the server as solid
 	m_is_solid = true;
+	m_profile_stats.solidify_usec = usec_since(solidify_start);
 }
 
 void FluidServer::liquefy()
@@ -277,6 +952,7 @@ void FluidServer::liquefy()
 	// Return early if already liquid
 	if (!m_is_solid)
 		return;
+	std::chrono::steady_clock::time_point liquefy_start = std::chrono::steady_clock::now();
 
 	// Loop over each of the ice blocks
 	for (IceBody3D* ice_body : m_ice_bodies)
@@ -284,13 +960,23 @@ void FluidServer::liquefy()
 		// Remove the droplets from this ice body, setting velocity for each in the process
 		Vector3 ice_linear_velocity = ice_body->get_linear_velocity();
 		Vector3 ice_angular_velocity = ice_body->get_angular_velocity();
+		// Make sure the droplets are exactly where the ice body has carried them
+		ice_body->update_droplet_transforms();
+		Transform3D ice_transform = ice_body->get_global_transform();
 		for (IceBody3D::DropletCollision& droplet_collision : ice_body->m_droplet_collisions)
 		{
-			droplet_collision.droplet_body->reparent(this);
-			droplet_collision.droplet_body->liquefy();
-			Vector3 droplet_offset = droplet_collision.droplet_body->get_global_position() - ice_body->get_global_position();
+			Transform3D droplet_transform = ice_transform * droplet_collision.local_transform;
+			Vector3 droplet_offset = droplet_transform.origin - ice_body->get_global_position();
 			Vector3 droplet_velocity = ice_linear_velocity + ice_angular_velocity.cross(droplet_offset);
-			droplet_collision.droplet_body->set_linear_velocity(droplet_velocity);
+			if (droplet_collision.droplet_body != nullptr)
+			{
+				droplet_collision.droplet_body->liquefy();
+				droplet_collision.droplet_body->set_linear_velocity(droplet_velocity);
+			}
+			else
+			{
+				liquefy_server_droplet(droplet_collision.droplet_rid, droplet_transform, droplet_velocity);
+			}
 		}
 		// Delete the ice body
 		ice_body->queue_free();
@@ -301,6 +987,7 @@ void FluidServer::liquefy()
 
 	// Mark the server as liquid
 	m_is_solid = false;
+	m_profile_stats.liquefy_usec = usec_since(liquefy_start);
 }
 
 // Getter for whether the droplets are frozen solid
@@ -321,35 +1008,891 @@ void FluidServer::set_ice_body_scene_path(const String ice_body_scene_path)
 	m_ice_body_scene_path = ice_body_scene_path;
 }
 
-// Adds droplets recursively to a set (helper for solidify())
-void FluidServer::add_droplet_to_set(DropletBody3D* droplet_body, DropletSet& droplet_set, Vector3& droplet_set_center)
+// Getters and setters for server droplet radius
+
+float FluidServer::get_server_droplet_radius() const
+{
+	return m_server_droplet_radius;
+}
+
+void FluidServer::set_server_droplet_radius(const float server_droplet_radius)
 {
-	// If droplet has not been added...
-	if (droplet_set.find(droplet_body) == droplet_set.end())
+	m_server_droplet_radius = server_droplet_radius;
+	// The shape is shared, so this resizes every droplet without a node
+	if (m_server_droplet_shape.is_valid())
 	{
-		// Add it to the set
-		droplet_set.insert(droplet_body);
-		droplet_set_center = (droplet_set_center * (droplet_set.size() - 1.0) + droplet_body->get_global_position()) / droplet_set.size();
-		// Recurse over the nearby droplets
-		for (DropletBody3D::NearbyDroplet next_nearby_droplet : droplet_body->m_nearby_droplets)
-		{
-			add_droplet_to_set(next_nearby_droplet.body, droplet_set, droplet_set_center);
-		}
+		m_physics_server->shape_set_data(m_server_droplet_shape, m_server_droplet_radius);
 	}
 }
 
-// Creates a new ice body at a given position, adds it to the array of ice bodies, and returns it
-IceBody3D* FluidServer::create_ice_body()
+// Getters and setters for server droplet mass (only affects droplets added afterwards)
+
+float FluidServer::get_server_droplet_mass() const
 {
-	IceBody3D* ice_body = Object::cast_to<IceBody3D>(m_ice_body_scene->instantiate());
-	add_child(ice_body);
-	ice_body->set_owner(get_owner());
+	return m_server_droplet_mass;
+}
+
+void FluidServer::set_server_droplet_mass(const float server_droplet_mass)
+{
+	m_server_droplet_mass = server_droplet_mass;
+}
+
+// Getters and setters for server droplet friction (only affects droplets added afterwards)
+
+float FluidServer::get_server_droplet_friction() const
+{
+	return m_server_droplet_friction;
+}
+
+void FluidServer::set_server_droplet_friction(const float server_droplet_friction)
+{
+	m_server_droplet_friction = server_droplet_friction;
+}
+
+// Getters and setters for server droplet bounce (only affects droplets added afterwards)
+
+float FluidServer::get_server_droplet_bounce() const
+{
+	return m_server_droplet_bounce;
+}
+
+void FluidServer::set_server_droplet_bounce(const float server_droplet_bounce)
+{
+	m_server_droplet_bounce = server_droplet_bounce;
+}
+
+// Getters and setters for server droplet collision layer (only affects droplets added afterwards)
+
+uint32_t FluidServer::get_server_droplet_collision_layer() const
+{
+	return m_server_droplet_collision_layer;
+}
+
+void FluidServer::set_server_droplet_collision_layer(const uint32_t server_droplet_collision_layer)
+{
+	m_server_droplet_collision_layer = server_droplet_collision_layer;
+}
+
+// Getters and setters for server droplet collision mask (only affects droplets added afterwards)
+
+uint32_t FluidServer::get_server_droplet_collision_mask() const
+{
+	return m_server_droplet_collision_mask;
+}
+
+void FluidServer::set_server_droplet_collision_mask(const uint32_t server_droplet_collision_mask)
+{
+	m_server_droplet_collision_mask = server_droplet_collision_mask;
+}
+
+// Getters and setters for publish snapshots
+
+bool FluidServer::get_publish_snapshots() const
+{
+	return m_publish_snapshots;
+}
+
+void FluidServer::set_publish_snapshots(const bool publish_snapshots)
+{
+	m_publish_snapshots = publish_snapshots;
+}
+
+// Getters and setters for spatial sort interval
+
+int32_t FluidServer::get_spatial_sort_interval() const
+{
+	return m_spatial_sort_interval;
+}
+
+void FluidServer::set_spatial_sort_interval(const int32_t spatial_sort_interval)
+{
+	m_spatial_sort_interval = spatial_sort_interval < 0 ? 0 : spatial_sort_interval;
+}
+
+// Getters and setters for use dormancy
+
+bool FluidServer::get_use_dormancy() const
+{
+	return m_use_dormancy;
+}
+
+void FluidServer::set_use_dormancy(const bool use_dormancy)
+{
+	m_use_dormancy = use_dormancy;
+	// Nothing will ever wake the dormant droplets once this is off
+	if (!m_use_dormancy)
+		wake_all_droplets();
+}
+
+// Getters and setters for dormancy velocity threshold
+
+float FluidServer::get_dormancy_velocity_threshold() const
+{
+	return m_dormancy_velocity_threshold;
+}
+
+void FluidServer::set_dormancy_velocity_threshold(const float dormancy_velocity_threshold)
+{
+	m_dormancy_velocity_threshold = dormancy_velocity_threshold;
+}
+
+// Getters and setters for dormancy ticks
+
+int32_t FluidServer::get_dormancy_ticks() const
+{
+	return m_dormancy_ticks;
+}
+
+void FluidServer::set_dormancy_ticks(const int32_t dormancy_ticks)
+{
+	m_dormancy_ticks = dormancy_ticks < 1 ? 1 : dormancy_ticks;
+	// Start counting again, since droplets already past the new number would never reach it
+	std::fill(m_droplets.quiet_ticks.begin(), m_droplets.quiet_ticks.end(), 0);
+}
+
+// Getters and setters for use async forces
+
+bool FluidServer::get_use_async_forces() const
+{
+	return m_use_async_forces;
+}
+
+void FluidServer::set_use_async_forces(const bool use_async_forces)
+{
+	m_use_async_forces = use_async_forces;
+	// Switching back finishes the forces being computed, but they are never applied
+	if (!m_use_async_forces)
+	{
+		m_solver.wait_for_step();
+		m_async_forces_pending = false;
+	}
+}
+
+// Getters and setters for precompute ice groups
+
+bool FluidServer::get_precompute_ice_groups() const
+{
+	return m_precompute_ice_groups;
+}
+
+void FluidServer::set_precompute_ice_groups(const bool precompute_ice_groups)
+{
+	m_precompute_ice_groups = precompute_ice_groups;
+}
+
+// Getters and setters for thread count (0 means one thread per CPU core)
+
+int32_t FluidServer::get_thread_count() const
+{
+	return m_solver.get_thread_count();
+}
+
+void FluidServer::set_thread_count(const int32_t thread_count)
+{
+	m_solver.set_thread_count(thread_count < 0 ? 0 : thread_count);
+}
+
+// Getters and setters for profiling enabled
+
+bool FluidServer::get_profiling_enabled() const
+{
+	return m_solver.get_count_pairs();
+}
+
+void FluidServer::set_profiling_enabled(const bool profiling_enabled)
+{
+	m_solver.wait_for_step();
+	m_solver.set_count_pairs(profiling_enabled);
+}
+
+// Gets the latest timings and counts, either all of them or one by name
+
+Dictionary FluidServer::get_profile_stats() const
+{
+	Dictionary profile_stats;
+	profile_stats["droplet_count"] = (int64_t)m_droplets.size();
+	profile_stats["gather_usec"] = m_profile_stats.gather_usec;
+	profile_stats["pair_loop_usec"] = m_profile_stats.pair_loop_usec;
+	profile_stats["neighbor_build_usec"] = m_profile_stats.neighbor_build_usec;
+	profile_stats["scatter_usec"] = m_profile_stats.scatter_usec;
+	profile_stats["physics_frame_usec"] = m_profile_stats.physics_frame_usec;
+	profile_stats["async_wait_usec"] = m_profile_stats.async_wait_usec;
+	profile_stats["snapshot_usec"] = m_profile_stats.snapshot_usec;
+	profile_stats["multimesh_usec"] = m_profile_stats.multimesh_usec;
+	profile_stats["solidify_usec"] = m_profile_stats.solidify_usec;
+	profile_stats["liquefy_usec"] = m_profile_stats.liquefy_usec;
+	profile_stats["pairs_tested"] = (int64_t)m_profile_stats.pairs_tested;
+	profile_stats["pairs_in_range"] = (int64_t)m_profile_stats.pairs_in_range;
+	profile_stats["neighbor_inserts"] = (int64_t)m_profile_stats.neighbor_inserts;
+	profile_stats["verlet_rebuilds"] = (int64_t)m_profile_stats.verlet_rebuilds;
+	profile_stats["verlet_rebuild_rate"] = m_profile_stats.verlet_rebuild_rate;
+	profile_stats["dormancy_usec"] = m_profile_stats.dormancy_usec;
+	profile_stats["dormant_droplets"] = (int64_t)m_profile_stats.dormant_droplets;
+	profile_stats["spatial_sort_usec"] = m_profile_stats.spatial_sort_usec;
+	profile_stats["components_usec"] = m_profile_stats.components_usec;
+	return profile_stats;
+}
+
+Variant FluidServer::get_profile_stat(const String& stat_name) const
+{
+	return get_profile_stats()[stat_name];
+}
+
+// Getters and setters for use multimesh
+
+bool FluidServer::get_use_multimesh() const
+{
+	return m_use_multimesh;
+}
+
+void FluidServer::set_use_multimesh(const bool use_multimesh)
+{
+	m_use_multimesh = use_multimesh;
+	// Switch over right away if already running
+	if (m_in_game && is_inside_tree())
+	{
+		if (m_use_multimesh)
+			create_multimesh();
+		else
+			destroy_multimesh();
+	}
+}
+
+// Getters and setters for droplet mesh
+
+Ref<Mesh> FluidServer::get_droplet_mesh() const
+{
+	return m_droplet_mesh;
+}
+
+void FluidServer::set_droplet_mesh(const Ref<Mesh> droplet_mesh)
+{
+	m_droplet_mesh = droplet_mesh;
+	if (m_multimesh.is_valid())
+	{
+		m_multimesh->set_mesh(m_droplet_mesh);
+	}
+}
+
+// Getters and setters for droplet material
+
+Ref<Material> FluidServer::get_droplet_material() const
+{
+	return m_droplet_material;
+}
+
+void FluidServer::set_droplet_material(const Ref<Material> droplet_material)
+{
+	m_droplet_material = droplet_material;
+	if (m_multimesh_instance != nullptr)
+	{
+		m_multimesh_instance->set_material_override(m_droplet_material);
+	}
+}
+
+// Rebuilds the neighbor table from the current positions if it is out of date
+void FluidServer::update_neighbor_table()
+{
+	// A table being built in the background is only usable once it is done
+	m_solver.wait_for_step();
+	// Positions can only be read in game
+	if (m_neighbor_table_valid || !m_in_game)
+		return;
+	std::chrono::steady_clock::time_point update_start = std::chrono::steady_clock::now();
+	gather_droplet_positions();
+	m_solver.collect_neighbors();
+	m_solver.build_neighbor_table();
+	m_neighbor_table_valid = true;
+	m_components_valid = false;
+	// Built on demand, so the whole update counts as building the table
+	m_profile_stats.neighbor_build_usec = usec_since(update_start);
+	m_profile_stats.neighbor_inserts = m_solver.get_neighbor_table().get_edge_count();
+}
+
+// Reads the position of each droplet into the solver, then has it sort them into its grid
+void FluidServer::gather_droplet_positions()
+{
+	read_droplet_positions();
+	m_solver.update_grid();
+}
+
+// Reads the position of each droplet into the solver
+void FluidServer::read_droplet_positions()
+{
+	bool skip_dormant = m_solver.get_dormant_count() > 0;
+	for (uint32_t i = 0; i < m_droplets.size(); ++i)
+	{
+		// Dormant droplets are asleep, so they are still where they were
+		if (skip_dormant && m_solver.is_dormant(i))
+			continue;
+		// Reading the physics server's state skips the node's virtual dispatch and global transform update
+		Vec3 droplet_position;
+		if (m_use_direct_body_state || m_droplets.body[i] == nullptr)
+			droplet_position = to_vec3(m_physics_server->body_get_direct_state(m_droplets.rid[i])->get_transform().origin);
+		else
+			droplet_position = to_vec3(m_droplets.body[i]->get_global_position());
+		m_solver.set_position(i, droplet_position);
+	}
+}
+
+// Applies the forces from the solver to each droplet (serially, since the physics server is not guaranteed to be
+// thread safe)
+void FluidServer::apply_droplet_forces()
+{
+	bool skip_dormant = m_solver.get_dormant_count() > 0;
+	for (uint32_t i = 0; i < m_droplets.size(); ++i)
+	{
+		// Applying a force (even a zero one) would wake a dormant droplet back up
+		if (skip_dormant && m_solver.is_dormant(i))
+			continue;
+		Vector3 droplet_force = to_vector3(m_solver.get_force(i));
+		if (m_use_direct_body_state || m_droplets.body[i] == nullptr)
+			m_physics_server->body_apply_central_force(m_droplets.rid[i], droplet_force);
+		else
+			m_droplets.body[i]->apply_central_force(droplet_force);
+	}
+}
+
+// Copies the droplets' current state into a snapshot buffer no reader is holding, then publishes it by swapping it
+// in as the latest snapshot
+void FluidServer::publish_droplet_snapshot()
+{
+	std::chrono::steady_clock::time_point snapshot_start = std::chrono::steady_clock::now();
+	// Find a buffer that only this server still refers to (neither published nor held by a reader), or make a new
+	// one if readers are holding on to all of them
+	std::shared_ptr<DropletSnapshot>* free_buffer = nullptr;
+	for (std::shared_ptr<DropletSnapshot>& snapshot_buffer : m_snapshot_buffers)
+	{
+		if (snapshot_buffer == nullptr || snapshot_buffer.use_count() == 1)
+		{
+			free_buffer = &snapshot_buffer;
+			break;
+		}
+	}
+	if (free_buffer == nullptr)
+		free_buffer = &m_snapshot_buffers[m_snapshot_frame % SNAPSHOT_BUFFER_COUNT];
+	if (*free_buffer == nullptr || free_buffer->use_count() > 1)
+		*free_buffer = std::make_shared<DropletSnapshot>();
+	DropletSnapshot& snapshot = **free_buffer;
+	// Fill it in (the positions are the ones just read into the solver)
+	int64_t droplet_count = m_droplets.size();
+	snapshot.frame = ++m_snapshot_frame;
+	snapshot.droplet_ids.resize(droplet_count);
+	snapshot.positions.resize(droplet_count);
+	snapshot.velocities.resize(droplet_count);
+	int64_t* droplet_ids = snapshot.droplet_ids.ptrw();
+	Vector3* positions = snapshot.positions.ptrw();
+	Vector3* velocities = snapshot.velocities.ptrw();
+	for (uint32_t i = 0; i < droplet_count; ++i)
+	{
+		droplet_ids[i] = m_droplets.rid[i].get_id();
+		positions[i] = to_vector3(m_solver.get_position(i));
+		if (m_use_direct_body_state || m_droplets.body[i] == nullptr)
+			velocities[i] = m_physics_server->body_get_direct_state(m_droplets.rid[i])->get_linear_velocity();
+		else
+			velocities[i] = m_droplets.body[i]->get_linear_velocity();
+	}
+	// Neighbor counts are only known when the neighbor table is kept up to date every frame
+	const NeighborTable& neighbor_table = m_solver.get_neighbor_table();
+	if (m_neighbor_table_valid && neighbor_table.get_point_count() == m_droplets.size())
+	{
+		snapshot.neighbor_counts.resize(droplet_count);
+		int32_t* neighbor_counts = snapshot.neighbor_counts.ptrw();
+		for (uint32_t i = 0; i < droplet_count; ++i)
+		{
+			neighbor_counts[i] = neighbor_table.get_neighbor_count(i);
+		}
+	}
+	else
+	{
+		snapshot.neighbor_counts.clear();
+	}
+	// Publish it (readers holding the previous snapshot keep it alive until they let go of it)
+	std::atomic_store(&m_published_snapshot, std::shared_ptr<const DropletSnapshot>(*free_buffer));
+	m_profile_stats.snapshot_usec = usec_since(snapshot_start);
+}
+
+// Applies the forces computed in the background since the last physics frame, then starts computing the next ones
+// from the current positions (so the forces always lag one physics frame behind the positions)
+void FluidServer::step_forces_async()
+{
+	std::chrono::steady_clock::time_point frame_start = std::chrono::steady_clock::now();
+	// Wait for the forces started last frame (normally they are done by now)
+	m_solver.wait_for_step();
+	m_profile_stats.async_wait_usec = usec_since(frame_start);
+	// Apply them, along with the stats from computing them
+	if (m_async_forces_pending)
+	{
+		const CohesionSolver::StepTimings& step_timings = m_solver.get_step_timings();
+		// The grid is built in the background as well, so it counts towards the pair loop
+		m_profile_stats.pair_loop_usec = step_timings.grid_usec + step_timings.pair_loop_usec;
+		m_profile_stats.pairs_tested = m_solver.get_pairs_tested();
+		m_profile_stats.pairs_in_range = m_solver.get_pairs_in_range();
+		read_verlet_stats();
+		if (m_neighbor_graph_mode == NEIGHBOR_GRAPH_MODE_EVERY_FRAME)
+		{
+			m_profile_stats.neighbor_build_usec = step_timings.neighbor_build_usec;
+			m_profile_stats.neighbor_inserts = m_solver.get_neighbor_table().get_edge_count();
+		}
+		if (m_precompute_ice_groups)
+			m_profile_stats.components_usec = step_timings.components_usec;
+		if (m_use_dormancy)
+			update_dormancy();
+		std::chrono::steady_clock::time_point scatter_start = std::chrono::steady_clock::now();
+		apply_droplet_forces();
+		m_profile_stats.scatter_usec = usec_since(scatter_start);
+	}
+	// Snapshot the positions for the next forces
+	std::chrono::steady_clock::time_point gather_start = std::chrono::steady_clock::now();
+	read_droplet_positions();
+	m_profile_stats.gather_usec = usec_since(gather_start);
+	// Publish the positions along with the neighbor table from the step that just finished (so the neighbor counts
+	// lag a physics frame behind, just like the forces)
+	if (m_publish_snapshots)
+		publish_droplet_snapshot();
+	// Compute them on the worker threads while the physics server steps and the rest of the frame runs
+	// (the pair loop leaves out the pairs between dormant droplets, so the table is only recorded without any)
+	bool record_neighbors = (m_neighbor_graph_mode == NEIGHBOR_GRAPH_MODE_EVERY_FRAME || m_precompute_ice_groups) &&
+		m_solver.get_dormant_count() == 0;
+	m_solver.begin_step(record_neighbors, m_precompute_ice_groups);
+	m_async_forces_pending = true;
+	// Anything that reads the neighbor table waits for the step first, by which point it matches these positions, and
+	// so do the groups if they were built with it
+	m_neighbor_table_valid = record_neighbors;
+	m_components_valid = record_neighbors && m_precompute_ice_groups;
+	m_profile_stats.physics_frame_usec = usec_since(frame_start);
+}
+
+// Adds a droplet body to the droplet arrays (but not to any ice body), returning false if it was already added
+bool FluidServer::insert_droplet_body(DropletBody3D* new_droplet_body)
+{
+	// See if it has already been added
+	int64_t droplet_id = new_droplet_body->get_rid().get_id();
+	if (m_droplet_indices.find(droplet_id) != m_droplet_indices.end())
+		return false;
+	// The solver cannot be touched while it is computing forces in the background
+	m_solver.wait_for_step();
+	// Add it as a child (skipping the reparent if it already is one, since that would leave and re-enter the tree)
+	if (!UtilityFunctions::is_instance_valid(new_droplet_body->get_parent()))
+	{
+		add_child(new_droplet_body);
+		new_droplet_body->set_owner(get_owner());
+	}
+	else if (new_droplet_body->get_parent() != this)
+	{
+		new_droplet_body->reparent(this, true);
+		new_droplet_body->set_owner(get_owner());
+	}
+	// Add it to the droplet arrays
+	m_droplet_indices[droplet_id] = m_droplets.push_back(new_droplet_body, new_droplet_body->get_rid());
+	m_solver.add_point(to_vec3(new_droplet_body->get_global_position()));
+	// The multimesh draws it instead of its own mesh
+	if (m_multimesh_instance != nullptr)
+	{
+		new_droplet_body->set_mesh_visible(false);
+	}
+	return true;
+}
+
+// Takes a droplet body out of the droplet arrays and its ice body, returning false if it was never added (the
+// neighbor table is left for the caller to clear)
+bool FluidServer::erase_droplet_body(DropletBody3D* old_droplet_body)
+{
+	// Try to find it
+	auto found_index_iter = m_droplet_indices.find(old_droplet_body->get_rid().get_id());
+	if (found_index_iter == m_droplet_indices.end())
+		return false;
+	// The solver cannot be touched while it is computing forces in the background
+	m_solver.wait_for_step();
+	// The droplet goes back to never sleeping once it leaves
+	uint32_t old_index = found_index_iter->second;
+	if (m_solver.is_dormant(old_index))
+		wake_droplet(old_index);
+	// Move the last droplet into the removed droplet's place
+	m_droplet_indices.erase(found_index_iter);
+	m_droplets.swap_remove(old_index);
+	m_solver.swap_remove_point(old_index);
+	if (old_index < m_droplets.size())
+	{
+		m_droplet_indices[m_droplets.rid[old_index].get_id()] = old_index;
+	}
+	// If currently in a solid state...
+	if (m_is_solid)
+	{
+		// Remove it from its ice body
+		for (IceBody3D* ice_body : m_ice_bodies)
+		{
+			if (ice_body->remove_droplet(old_droplet_body))
+				break;
+		}
+		// Start processing on it again
+		old_droplet_body->liquefy();
+	}
+	// It is no longer drawn by the multimesh
+	if (m_multimesh_instance != nullptr)
+	{
+		old_droplet_body->set_mesh_visible(true);
+	}
+	return true;
+}
+
+// Creates a new ice body at a given position, adds it to the array of ice bodies, and returns it
+IceBody3D* FluidServer::create_ice_body()
+{
+	IceBody3D* ice_body = Object::cast_to<IceBody3D>(m_ice_body_scene->instantiate());
+	add_child(ice_body);
+	ice_body->set_owner(get_owner());
 	m_ice_bodies.push_back(ice_body);
 	return ice_body;
 }
 
 
 
+// Freezes/melts a droplet that only exists in the physics server, the same way DropletBody3D does for itself
+
+void FluidServer::solidify_server_droplet(const RID& droplet_rid)
+{
+	m_physics_server->body_set_mode(droplet_rid, PhysicsServer3D::BODY_MODE_STATIC);
+	m_physics_server->body_set_collision_layer(droplet_rid, 0);
+	m_physics_server->body_set_collision_mask(droplet_rid, 0);
+}
+
+void FluidServer::liquefy_server_droplet(const RID& droplet_rid, const Transform3D& droplet_transform, const Vector3& droplet_velocity)
+{
+	m_physics_server->body_set_state(droplet_rid, PhysicsServer3D::BODY_STATE_TRANSFORM, droplet_transform);
+	m_physics_server->body_set_mode(droplet_rid, PhysicsServer3D::BODY_MODE_RIGID_LINEAR);
+	m_physics_server->body_set_collision_layer(droplet_rid, m_server_droplet_collision_layer);
+	m_physics_server->body_set_collision_mask(droplet_rid, m_server_droplet_collision_mask);
+	m_physics_server->body_set_state(droplet_rid, PhysicsServer3D::BODY_STATE_LINEAR_VELOCITY, droplet_velocity);
+}
+
+// Creates the multimesh that draws the droplets and hides the droplets' own meshes
+void FluidServer::create_multimesh()
+{
+	// Return early if it already exists
+	if (m_multimesh_instance != nullptr)
+		return;
+	// Each instance is a 3D transform plus custom data, where the custom data's x is 1 if the droplet is solid
+	m_multimesh.instantiate();
+	m_multimesh->set_transform_format(MultiMesh::TRANSFORM_3D);
+	m_multimesh->set_use_custom_data(true);
+	m_multimesh->set_mesh(m_droplet_mesh);
+	// The buffer holds global transforms, so the instance ignores this node's transform
+	m_multimesh_instance = memnew(MultiMeshInstance3D);
+	m_multimesh_instance->set_multimesh(m_multimesh);
+	m_multimesh_instance->set_material_override(m_droplet_material);
+	m_multimesh_instance->set_as_top_level(true);
+	add_child(m_multimesh_instance);
+	// Hide the droplets' own meshes
+	for (DropletBody3D* droplet_body : m_droplets.body)
+	{
+		if (droplet_body != nullptr)
+			droplet_body->set_mesh_visible(false);
+	}
+}
+
+// Destroys the multimesh that draws the droplets and shows the droplets' own meshes again
+void FluidServer::destroy_multimesh()
+{
+	// Return early if it does not exist
+	if (m_multimesh_instance == nullptr)
+		return;
+	m_multimesh_instance->queue_free();
+	m_multimesh_instance = nullptr;
+	m_multimesh.unref();
+	m_multimesh_buffer.resize(0);
+	// The frozen droplets' nodes were left behind while the multimesh drew them, so catch them up
+	for (IceBody3D* ice_body : m_ice_bodies)
+	{
+		ice_body->update_droplet_transforms();
+	}
+	// Show the droplets' own meshes
+	for (DropletBody3D* droplet_body : m_droplets.body)
+	{
+		if (droplet_body != nullptr)
+			droplet_body->set_mesh_visible(true);
+	}
+}
+
+// Writes every droplet's transform and solid flag into the multimesh buffer, then hands the whole buffer over at once
+void FluidServer::update_multimesh()
+{
+	// Use the mesh of the droplets themselves if no mesh was given
+	if (m_droplet_mesh.is_null())
+	{
+		for (DropletBody3D* droplet_body : m_droplets.body)
+		{
+			if (droplet_body != nullptr && UtilityFunctions::is_instance_valid(droplet_body->m_mesh_instance))
+			{
+				m_droplet_mesh = droplet_body->m_mesh_instance->get_mesh();
+				m_multimesh->set_mesh(m_droplet_mesh);
+				break;
+			}
+		}
+	}
+	// Changing the instance count clears the multimesh, so only do it when the number of droplets changes
+	if (m_multimesh->get_instance_count() != (int32_t)m_droplets.size())
+	{
+		m_multimesh->set_instance_count(m_droplets.size());
+		m_multimesh_buffer.resize(m_droplets.size() * MULTIMESH_FLOATS_PER_INSTANCE);
+	}
+	float* buffer = m_multimesh_buffer.ptrw();
+	// Writes one instance (the transform is stored as the three rows of its 3x4 matrix)
+	auto write_instance = [buffer] (uint32_t index, const Transform3D& transform, float solid)
+	{
+		float* instance = buffer + index * MULTIMESH_FLOATS_PER_INSTANCE;
+		for (int row = 0; row < 3; ++row)
+		{
+			instance[row * 4 + 0] = transform.basis.rows[row].x;
+			instance[row * 4 + 1] = transform.basis.rows[row].y;
+			instance[row * 4 + 2] = transform.basis.rows[row].z;
+			instance[row * 4 + 3] = transform.origin[row];
+		}
+		instance[12] = solid;
+		instance[13] = 0.0;
+		instance[14] = 0.0;
+		instance[15] = 0.0;
+	};
+	// When solid, every droplet belongs to an ice body, so place them from the ice body's transform
+	if (m_is_solid)
+	{
+		for (IceBody3D* ice_body : m_ice_bodies)
+		{
+			Transform3D ice_transform = ice_body->get_global_transform();
+			for (IceBody3D::DropletCollision& droplet_collision : ice_body->m_droplet_collisions)
+			{
+				write_instance(m_droplet_indices[droplet_collision.droplet_rid.get_id()], ice_transform * droplet_collision.local_transform, 1.0);
+			}
+		}
+	}
+	// Otherwise read each droplet's current transform
+	else
+	{
+		for (uint32_t i = 0; i < m_droplets.size(); ++i)
+		{
+			if (m_use_direct_body_state || m_droplets.body[i] == nullptr)
+				write_instance(i, m_physics_server->body_get_direct_state(m_droplets.rid[i])->get_transform(), 0.0);
+			else
+				write_instance(i, m_droplets.body[i]->get_global_transform(), 0.0);
+		}
+	}
+	m_multimesh->set_buffer(m_multimesh_buffer);
+}
+// Registers the profile stats as custom monitors with the Performance singleton (so they show up in the debugger)
+void FluidServer::add_profile_monitors()
+{
+	if (m_profile_monitors_added || Engine::get_singleton()->is_editor_hint())
+		return;
+	Performance* performance = Performance::get_singleton();
+	String category = String("FluidServer (") + String(get_name()) + ")/";
+	for (const char* stat_name : PROFILE_STAT_NAMES)
+	{
+		StringName monitor_id = category + stat_name;
+		if (!performance->has_custom_monitor(monitor_id))
+		{
+			performance->add_custom_monitor(monitor_id, Callable(this, "get_profile_stat"), Array::make(String(stat_name)));
+		}
+	}
+	m_profile_monitors_added = true;
+}
+
+// Unregisters the custom monitors added by add_profile_monitors()
+void FluidServer::remove_profile_monitors()
+{
+	if (!m_profile_monitors_added)
+		return;
+	Performance* performance = Performance::get_singleton();
+	String category = String("FluidServer (") + String(get_name()) + ")/";
+	for (const char* stat_name : PROFILE_STAT_NAMES)
+	{
+		StringName monitor_id = category + stat_name;
+		if (performance->has_custom_monitor(monitor_id))
+		{
+			performance->remove_custom_monitor(monitor_id);
+		}
+	}
+	m_profile_monitors_added = false;
+}
+
+// Wakes up the dormant clusters that something has come near, then counts how long each awake droplet has been
+// moving slower than the velocity threshold, and puts to sleep any cluster whose droplets have all been that slow
+// for long enough
+void FluidServer::update_dormancy()
+{
+	std::chrono::steady_clock::time_point dormancy_start = std::chrono::steady_clock::now();
+	// Clusters that an awake droplet came within the effective distance of during the pair loop
+	std::vector<uint32_t> waking_clusters = m_solver.get_disturbed_clusters();
+	float velocity_threshold_squared = m_dormancy_velocity_threshold * m_dormancy_velocity_threshold;
+	bool any_newly_quiet = false;
+	for (uint32_t i = 0; i < m_droplets.size(); ++i)
+	{
+		// Dormant droplets that the physics server woke up (such as when something hit them) wake their whole cluster
+		if (m_solver.is_dormant(i))
+		{
+			bool is_sleeping;
+			if (m_use_direct_body_state || m_droplets.body[i] == nullptr)
+				is_sleeping = m_physics_server->body_get_direct_state(m_droplets.rid[i])->is_sleeping();
+			else
+				is_sleeping = m_droplets.body[i]->is_sleeping();
+			if (!is_sleeping)
+				waking_clusters.push_back(m_solver.get_dormant_cluster(i));
+			continue;
+		}
+		// Awake droplets count how many frames in a row they have been slow
+		Vector3 droplet_velocity;
+		if (m_use_direct_body_state || m_droplets.body[i] == nullptr)
+			droplet_velocity = m_physics_server->body_get_direct_state(m_droplets.rid[i])->get_linear_velocity();
+		else
+			droplet_velocity = m_droplets.body[i]->get_linear_velocity();
+		if (droplet_velocity.length_squared() < velocity_threshold_squared)
+		{
+			// Stops counting just past the number of ticks, so that it only reaches it once
+			if (m_droplets.quiet_ticks[i] <= (uint32_t)m_dormancy_ticks)
+				++m_droplets.quiet_ticks[i];
+			any_newly_quiet = any_newly_quiet || m_droplets.quiet_ticks[i] == (uint32_t)m_dormancy_ticks;
+		}
+		else
+		{
+			m_droplets.quiet_ticks[i] = 0;
+		}
+	}
+	// Wake the clusters up
+	if (!waking_clusters.empty())
+	{
+		std::sort(waking_clusters.begin(), waking_clusters.end());
+		for (uint32_t i = 0; i < m_droplets.size(); ++i)
+		{
+			if (m_solver.is_dormant(i) && std::binary_search(waking_clusters.begin(), waking_clusters.end(), m_solver.get_dormant_cluster(i)))
+				wake_droplet(i);
+		}
+	}
+	// A cluster can only have become quiet if one of its droplets just did
+	if (any_newly_quiet)
+	{
+		// Group the droplets that are touching (dormant droplets count as quiet, so a cluster settling against a
+		// dormant one joins it)
+		update_neighbor_table();
+		if (!m_components_valid)
+			m_solver.build_components();
+		m_components_valid = true;
+		const ConnectedComponents& droplet_components = m_solver.get_components();
+		for (uint32_t component = 0; component < droplet_components.get_component_count(); ++component)
+		{
+			const uint32_t* component_droplets = droplet_components.get_members(component);
+			uint32_t component_size = droplet_components.get_member_count(component);
+			bool is_quiet = true;
+			bool is_all_dormant = true;
+			for (uint32_t i = 0; i < component_size && is_quiet; ++i)
+			{
+				uint32_t droplet_index = component_droplets[i];
+				bool is_dormant = m_solver.is_dormant(droplet_index);
+				is_quiet = is_dormant || m_droplets.quiet_ticks[droplet_index] >= (uint32_t)m_dormancy_ticks;
+				is_all_dormant = is_all_dormant && is_dormant;
+			}
+			if (!is_quiet || is_all_dormant)
+				continue;
+			// Put the whole group to sleep as one new cluster
+			uint32_t cluster = m_next_dormant_cluster++;
+			if (m_next_dormant_cluster == CohesionSolver::NO_DORMANT_CLUSTER)
+				m_next_dormant_cluster = 0;
+			for (uint32_t i = 0; i < component_size; ++i)
+			{
+				put_droplet_to_sleep(component_droplets[i], cluster);
+			}
+		}
+	}
+	m_profile_stats.dormant_droplets = m_solver.get_dormant_count();
+	m_profile_stats.dormancy_usec = usec_since(dormancy_start);
+}
+
+// Marks a droplet as dormant in the solver and lets the physics server put its body to sleep
+void FluidServer::put_droplet_to_sleep(uint32_t droplet_index, uint32_t cluster)
+{
+	m_solver.set_dormant_cluster(droplet_index, cluster);
+	if (m_use_direct_body_state || m_droplets.body[droplet_index] == nullptr)
+	{
+		m_physics_server->body_set_state(m_droplets.rid[droplet_index], PhysicsServer3D::BODY_STATE_CAN_SLEEP, true);
+		m_physics_server->body_set_state(m_droplets.rid[droplet_index], PhysicsServer3D::BODY_STATE_SLEEPING, true);
+	}
+	else
+	{
+		m_droplets.body[droplet_index]->set_can_sleep(true);
+		m_droplets.body[droplet_index]->set_sleeping(true);
+	}
+}
+
+// Wakes a droplet back up, in the solver and the physics server (where it goes back to never sleeping)
+void FluidServer::wake_droplet(uint32_t droplet_index)
+{
+	m_solver.set_dormant_cluster(droplet_index, CohesionSolver::NO_DORMANT_CLUSTER);
+	m_droplets.quiet_ticks[droplet_index] = 0;
+	if (m_use_direct_body_state || m_droplets.body[droplet_index] == nullptr)
+	{
+		m_physics_server->body_set_state(m_droplets.rid[droplet_index], PhysicsServer3D::BODY_STATE_CAN_SLEEP, false);
+		m_physics_server->body_set_state(m_droplets.rid[droplet_index], PhysicsServer3D::BODY_STATE_SLEEPING, false);
+	}
+	else
+	{
+		m_droplets.body[droplet_index]->set_can_sleep(false);
+		m_droplets.body[droplet_index]->set_sleeping(false);
+	}
+}
+
+// Wakes up every dormant droplet
+void FluidServer::wake_all_droplets()
+{
+	m_solver.wait_for_step();
+	for (uint32_t i = 0; i < m_droplets.size() && m_solver.get_dormant_count() > 0; ++i)
+	{
+		if (m_solver.is_dormant(i))
+			wake_droplet(i);
+	}
+	m_profile_stats.dormant_droplets = 0;
+}
+
+// Reorders the droplets along a Morton curve by their last known positions, so that the pair loop and the neighbor
+// table mostly touch droplets that are next to each other in memory (the droplets' RIDs stay the same, only their
+// indices change)
+void FluidServer::sort_droplets_spatially()
+{
+	std::chrono::steady_clock::time_point sort_start = std::chrono::steady_clock::now();
+	// Forces being computed in the background are reordered along with everything else
+	m_solver.wait_for_step();
+	const std::vector<uint32_t>& order = m_solver.sort_points_spatially();
+	m_droplets.permute(order);
+	for (uint32_t i = 0; i < m_droplets.size(); ++i)
+	{
+		m_droplet_indices[m_droplets.rid[i].get_id()] = i;
+	}
+	m_neighbor_table_valid = false;
+	m_profile_stats.spatial_sort_usec = usec_since(sort_start);
+}
+
+// Checks that a domain exists, printing an error if not
+bool FluidServer::is_valid_domain(const int32_t domain) const
+{
+	if (domain >= 0 && domain < (int32_t)m_solver.get_domain_count())
+		return true;
+	UtilityFunctions::printerr("Domain ", domain, " does not exist (", this, " has ", (int64_t)m_solver.get_domain_count(), " domains)");
+	return false;
+}
+
+// Copies how often the solver has had to rebuild its cached nearby pairs into the profile stats
+void FluidServer::read_verlet_stats()
+{
+	m_profile_stats.verlet_rebuilds = m_solver.get_verlet_rebuild_count();
+	uint64_t verlet_steps = m_solver.get_verlet_step_count();
+	m_profile_stats.verlet_rebuild_rate = verlet_steps > 0 ? (double)m_profile_stats.verlet_rebuilds / verlet_steps : 0.0;
+}
+
+// Gets the number of microseconds since a time point
+double FluidServer::usec_since(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+
 // Notification Methods
 
 // Called when the node enters the scene tree for the first time.
@@ -369,52 +1912,114 @@ void FluidServer::_on_ready()
 	{
 		m_ice_body_scene = ResourceLoader::get_singleton()->load(m_ice_body_scene_path);
 	}
+	// Set up the multimesh if the droplets should be drawn all at once
+	if (m_in_game && m_use_multimesh)
+	{
+		create_multimesh();
+	}
+}
+
+// Called when the node is about to be deleted.
+void FluidServer::_on_predelete()
+{
+	// Finish any forces being computed in the background before anything goes away
+	m_solver.wait_for_step();
+	// Droplets without nodes are not freed along with the scene tree, so free their bodies and shape here
+	if (m_physics_server == nullptr)
+		return;
+	for (uint32_t i = 0; i < m_droplets.size(); ++i)
+	{
+		if (m_droplets.body[i] == nullptr)
+			m_physics_server->free_rid(m_droplets.rid[i]);
+	}
+	if (m_server_droplet_shape.is_valid())
+	{
+		m_physics_server->free_rid(m_server_droplet_shape);
+	}
+}
+
+// Called every frame. 'delta' is the elapsed time since the previous frame.
+void FluidServer::_on_process(double delta)
+{
+	// Draw every droplet in one go
+	if (m_multimesh_instance != nullptr)
+	{
+		std::chrono::steady_clock::time_point multimesh_start = std::chrono::steady_clock::now();
+		update_multimesh();
+		m_profile_stats.multimesh_usec = usec_since(multimesh_start);
+	}
+	// While solid, move the frozen droplets along with their ice bodies (they are not children of the ice bodies),
+	// unless the multimesh is drawing them, in which case the nodes only need to catch up when they melt
+	else if (m_in_game && m_is_solid)
+	{
+		for (IceBody3D* ice_body : m_ice_bodies)
+		{
+			ice_body->update_droplet_transforms();
+		}
+	}
 }
 
 // Called every physics frame. 'delta' is the elapsed time since the previous frame.
 void FluidServer::_on_physics_process(double delta)
 {
+	// Every so often, put the droplets that are near each other next to each other in memory
+	if (m_in_game && !m_is_solid && m_spatial_sort_interval > 0 && ++m_frames_since_spatial_sort >= m_spatial_sort_interval)
+	{
+		sort_droplets_spatially();
+		m_frames_since_spatial_sort = 0;
+	}
+	// Overlap computing the forces with the physics step, at the cost of a frame of latency
+	if (m_in_game && !m_is_solid && m_use_async_forces)
+	{
+		step_forces_async();
+	}
 	// Only run if in game and not currently solid
-	if (m_in_game && !m_is_solid)
+	else if (m_in_game && !m_is_solid)
 	{
-		// Get the current position of each droplet
-		for (DropletRecord& droplet_record : m_droplet_records)
+		// Time each phase of the frame
+		std::chrono::steady_clock::time_point frame_start = std::chrono::steady_clock::now();
+		std::chrono::steady_clock::time_point phase_start = frame_start;
+		// Get the current position of each droplet and sort them into the grid
+		gather_droplet_positions();
+		m_profile_stats.gather_usec = usec_since(phase_start);
+		phase_start = std::chrono::steady_clock::now();
+		// Only collect nearby pairs if the neighbor table (or the groups built from it) is kept up to date every frame,
+		// and there are no dormant droplets (the pair loop leaves out the pairs between them, so they would be missing)
+		bool record_neighbors = (m_neighbor_graph_mode == NEIGHBOR_GRAPH_MODE_EVERY_FRAME || m_precompute_ice_groups) &&
+			m_solver.get_dormant_count() == 0;
+		// Sum up the forces by looping over pairs of droplets
+		m_solver.accumulate_forces(record_neighbors);
+		m_profile_stats.pair_loop_usec = usec_since(phase_start);
+		m_profile_stats.pairs_tested = m_solver.get_pairs_tested();
+		m_profile_stats.pairs_in_range = m_solver.get_pairs_in_range();
+		read_verlet_stats();
+		phase_start = std::chrono::steady_clock::now();
+		// Turn the nearby pairs into the neighbor table, or mark it as out of date since the droplets have moved
+		if (record_neighbors)
 		{
-			droplet_record.position = Vec3(droplet_record.body->get_global_position());
-			droplet_record.body->clear_nearby_droplets();
+			m_solver.build_neighbor_table();
+			m_profile_stats.neighbor_build_usec = usec_since(phase_start);
+			m_profile_stats.neighbor_inserts = m_solver.get_neighbor_table().get_edge_count();
 		}
-		// Sum up the forces by looping over pairs of droplets
-		// Outer loop to get first droplet
-		std::for_each(std::execution::par, m_droplet_records.begin(), m_droplet_records.end(), [this] (DropletRecord& droplet_record_a)
+		// Group the connected droplets now, so that freezing them only has to create the ice bodies
+		if (record_neighbors && m_precompute_ice_groups)
 		{
-			// Get an iterator to the first droplet
-			auto droplet_a_iter = m_droplet_records.begin() + (&droplet_record_a - &m_droplet_records.front());
-			// Inner loop to get second droplet
-			std::for_each(std::execution::par, droplet_a_iter + 1, m_droplet_records.end(), [this, &droplet_record_a] (DropletRecord& droplet_record_b)
-			{
-				// Test if the droplets are close enough
-				float distance_squared = droplet_record_a.position.distance_squared(droplet_record_b.position);
-				if (distance_squared < m_force_effective_distance_squared)
-				{
-					// Apply cohesive forces
-					Vec3 force_direction = (droplet_record_a.position - droplet_record_b.position).normalized();
-					droplet_record_a.mutex->lock();
-					droplet_record_a.force += -m_force_magnitude * force_direction;
-					droplet_record_a.mutex->unlock();
-					droplet_record_b.mutex->lock();
-					droplet_record_b.force += +m_force_magnitude * force_direction;
-					droplet_record_b.mutex->unlock();
-					// Inform the droplets that they are near each other
-					droplet_record_a.body->add_nearby_droplet(droplet_record_b.body, distance_squared);
-					droplet_record_b.body->add_nearby_droplet(droplet_record_a.body, distance_squared);
-				}
-			});
-		});
+			phase_start = std::chrono::steady_clock::now();
+			m_solver.build_components();
+			m_profile_stats.components_usec = usec_since(phase_start);
+		}
+		m_neighbor_table_valid = record_neighbors;
+		m_components_valid = record_neighbors && m_precompute_ice_groups;
+		// Wake up or put to sleep clusters of droplets depending on how much they are moving
+		if (m_use_dormancy)
+			update_dormancy();
+		phase_start = std::chrono::steady_clock::now();
 		// Apply the forces for each droplet
-		std::for_each(std::execution::par, m_droplet_records.begin(), m_droplet_records.end(), [this] (DropletRecord& droplet_record)
-		{
-			droplet_record.body->apply_central_force(Vector3(droplet_record.force));
-			droplet_record.force = Vec3::ZERO;
-		});
+		apply_droplet_forces();
+		m_profile_stats.scatter_usec = usec_since(phase_start);
+		// Let other threads see where the droplets are without touching the simulation
+		if (m_publish_snapshots)
+			publish_droplet_snapshot();
+		m_profile_stats.physics_frame_usec = usec_since(frame_start);
 	}
 }
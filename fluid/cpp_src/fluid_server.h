@@ -4,13 +4,26 @@
 #include <godot_cpp/classes/node3d.hpp>
 #include <godot_cpp/classes/packed_scene.hpp>
 #include <godot_cpp/classes/physics_server3d.hpp>
+#include <godot_cpp/classes/multi_mesh.hpp>
+#include <godot_cpp/classes/multi_mesh_instance3d.hpp>
+#include <godot_cpp/classes/mesh.hpp>
+#include <godot_cpp/classes/material.hpp>
+#include <godot_cpp/variant/packed_float32_array.hpp>
+#include <godot_cpp/variant/packed_vector3_array.hpp>
+#include <godot_cpp/variant/packed_int32_array.hpp>
+#include <godot_cpp/variant/packed_int64_array.hpp>
+#include <godot_cpp/variant/typed_array.hpp>
+#include <godot_cpp/variant/dictionary.hpp>
 
 #include <vector>
-#include <unordered_set>
-#include <execution>
-#include <mutex>
+#include <array>
+#include <memory>
+#include <algorithm>
+#include <unordered_map>
+#include <chrono>
 
-#include "vec3.h"
+#include "cohesion_solver.h"
+#include "godot_vec3.h"
 #include "droplet_body_3d.h"
 #include "ice_body_3d.h"
 
@@ -20,34 +33,149 @@ namespace godot
 	{
 		GDCLASS(FluidServer, Node3D)
 
+	public:
+		// How the cohesive forces are summed up in the pair loop
+		enum ForceAccumulationMode
+		{
+			// Each pair is visited once, locking both droplets to add the force to each of them
+			FORCE_ACCUMULATION_MODE_LOCKED = COHESION_ACCUMULATION_MODE_LOCKED,
+			// Each pair is visited twice, once from each side, and each droplet only sums its own force
+			FORCE_ACCUMULATION_MODE_GATHER = COHESION_ACCUMULATION_MODE_GATHER
+		};
+
+		// How accurately the vectorized kernel computes distances (only used in the gather mode)
+		enum KernelPrecision
+		{
+			// A full square root and division per pair
+			KERNEL_PRECISION_EXACT = COHESION_KERNEL_PRECISION_EXACT,
+			// A reciprocal square root estimate with one refinement step
+			KERNEL_PRECISION_REFINED = COHESION_KERNEL_PRECISION_REFINED,
+			// A raw reciprocal square root estimate
+			KERNEL_PRECISION_FAST = COHESION_KERNEL_PRECISION_FAST
+		};
+
+		// When the table of nearby droplets is built
+		enum NeighborGraphMode
+		{
+			// Every physics frame, as part of the pair loop
+			NEIGHBOR_GRAPH_MODE_EVERY_FRAME,
+			// Only when something asks for it (such as solidify() or get_nearby_droplets()), from the current positions
+			NEIGHBOR_GRAPH_MODE_ON_DEMAND
+		};
+
 	private:
-		// A set of droplets
-		typedef std::unordered_set<DropletBody3D*> DropletSet;
+		// The engine side of the droplets in the server, stored in the same order as the solver's points
+		// (droplets that only exist in the physics server have a null body), along with how many physics frames in
+		// a row each droplet has been moving slower than the dormancy velocity threshold
+		struct DropletArrays
+		{
+			// Properties
+			std::vector<DropletBody3D*> body;
+			std::vector<RID> rid;
+			std::vector<uint32_t> quiet_ticks;
+			// Methods
+			size_t size() const;
+			void reserve(size_t capacity);
+			uint32_t push_back(DropletBody3D* p_body, const RID& p_rid);
+			void swap_remove(uint32_t index);
+			void permute(const std::vector<uint32_t>& order);
+		};
+
+		// Timings (in microseconds) and counts from the most recent physics frame, render frame, solidify(), and liquefy(),
+		// along with how many times the nearby pairs cached with a Verlet skin have been rebuilt and in what fraction of
+		// physics frames (both since verlet_skin was last set)
+		struct ProfileStats
+		{
+			// Properties
+			double gather_usec = 0.0;
+			double pair_loop_usec = 0.0;
+			double neighbor_build_usec = 0.0;
+			double scatter_usec = 0.0;
+			double physics_frame_usec = 0.0;
+			double async_wait_usec = 0.0;
+			double snapshot_usec = 0.0;
+			double multimesh_usec = 0.0;
+			double solidify_usec = 0.0;
+			double liquefy_usec = 0.0;
+			uint64_t pairs_tested = 0;
+			uint64_t pairs_in_range = 0;
+			uint64_t neighbor_inserts = 0;
+			uint64_t verlet_rebuilds = 0;
+			double verlet_rebuild_rate = 0.0;
+			double dormancy_usec = 0.0;
+			uint64_t dormant_droplets = 0;
+			double spatial_sort_usec = 0.0;
+			double components_usec = 0.0;
+		};
 
-		// A struct to hold information about each droplet
-		struct DropletRecord
+		// A copy of the droplets' state at the end of one physics frame, which is never changed once published (droplet
+		// i in each array is the same droplet, and its ID is the ID of its body RID)
+		struct DropletSnapshot
 		{
 			// Properties
-			DropletBody3D* body;
-			Vec3 position;
-			Vec3 force;
-			std::shared_ptr<std::mutex> mutex; // std::mutex cannot be copied, so instead we pass around a pointer to it
-			// Constructor
-			DropletRecord() : body(nullptr), position(0.0), force(0.0), mutex(nullptr)
-			{
-				mutex = std::make_shared<std::mutex>();
-			}
+			uint64_t frame = 0;
+			PackedInt64Array droplet_ids;
+			PackedVector3Array positions;
+			PackedVector3Array velocities;
+			PackedInt32Array neighbor_counts;
 		};
 
-		// A dynamic array of Droplet structs
-		std::vector<DropletRecord> m_droplet_records;
+		// The number of snapshot buffers that are reused (one published, one being read, and one being filled)
+		static const size_t SNAPSHOT_BUFFER_COUNT = 3;
+
+		// The number of floats per droplet in the multimesh buffer (a 3x4 transform followed by the custom data)
+		static const size_t MULTIMESH_FLOATS_PER_INSTANCE = 16;
+
+		// The droplets in this server
+		DropletArrays m_droplets;
+
+		// Maps the ID of each droplet's body RID to its index in the droplet arrays
+		std::unordered_map<int64_t, uint32_t> m_droplet_indices;
 
-		// The magnitude of the attraction force
-		float m_force_magnitude;
+		// The cohesion simulation, which holds the droplet positions and forces (droplet i is point i), the grid,
+		// the neighbor table, and the groups of connected droplets
+		CohesionSolver m_solver;
 
-		// The distance that the attraction force is effective over
-		float m_force_effective_distance;
-		float m_force_effective_distance_squared;
+		// Whether the solver's neighbor table matches the current droplets and positions
+		bool m_neighbor_table_valid;
+
+		// Whether the groups of connected droplets are found along with the neighbor table in every liquid physics
+		// frame, along with whether the solver's groups were built from its current neighbor table (only meaningful
+		// while the table is valid, since rebuilding the table leaves the groups out of date)
+		bool m_precompute_ice_groups;
+		bool m_components_valid;
+
+		// When the table of nearby droplets is built
+		NeighborGraphMode m_neighbor_graph_mode;
+
+		// How many physics frames go by between reordering the droplets by position (0 never does), and how many have
+		// gone by since the last time
+		int32_t m_spatial_sort_interval;
+		int32_t m_frames_since_spatial_sort;
+
+		// Whether clusters of droplets that have all been moving slower than the velocity threshold for the given number
+		// of physics frames go dormant, along with the number given to the next cluster to go dormant
+		bool m_use_dormancy;
+		float m_dormancy_velocity_threshold;
+		int32_t m_dormancy_ticks;
+		uint32_t m_next_dormant_cluster;
+
+		// Whether the forces are computed in the background while the physics server steps, and applied a physics
+		// frame later, along with whether there are forces waiting to be applied
+		bool m_use_async_forces;
+		bool m_async_forces_pending;
+
+		// Whether each physics frame publishes a snapshot of the droplets' state, along with the buffers the snapshots
+		// are filled in, the latest published snapshot (only ever read and written with atomic loads and stores), and
+		// the number of snapshots published so far
+		bool m_publish_snapshots;
+		std::array<std::shared_ptr<DropletSnapshot>, SNAPSHOT_BUFFER_COUNT> m_snapshot_buffers;
+		std::shared_ptr<const DropletSnapshot> m_published_snapshot;
+		uint64_t m_snapshot_frame;
+
+		// Whether droplet positions and forces go straight through the physics server (using each droplet's RID)
+		// rather than through the droplet nodes
+		bool m_use_direct_body_state;
 
 		// Whether the droplets are currently frozen solid
 		bool m_is_solid;
@@ -59,6 +187,36 @@ namespace godot
 		String m_ice_body_scene_path;
 		Ref<PackedScene> m_ice_body_scene;
 
+		// The physical properties of droplets that only exist in the physics server
+		float m_server_droplet_radius;
+		float m_server_droplet_mass;
+		float m_server_droplet_friction;
+		float m_server_droplet_bounce;
+		uint32_t m_server_droplet_collision_layer;
+		uint32_t m_server_droplet_collision_mask;
+
+		// The sphere shape shared by all droplets that only exist in the physics server
+		RID m_server_droplet_shape;
+
+		// Whether the droplets are all drawn by one multimesh instead of each by its own mesh
+		bool m_use_multimesh;
+
+		// The mesh and material used by the multimesh (the material's shader can read whether each droplet is solid
+		// from INSTANCE_CUSTOM.x)
+		Ref<Mesh> m_droplet_mesh;
+		Ref<Material> m_droplet_material;
+
+		// The multimesh that draws the droplets, along with the buffer its instances are written into
+		MultiMeshInstance3D* m_multimesh_instance;
+		Ref<MultiMesh> m_multimesh;
+		PackedFloat32Array m_multimesh_buffer;
+
+		// The latest timings and counts (whether the pair counters are kept up to date lives in the solver)
+		ProfileStats m_profile_stats;
+
+		// Whether the profile stats are registered as custom monitors with the Performance singleton
+		bool m_profile_monitors_added;
+
 		// Whether currently in-game
 		bool m_in_game;
 
@@ -81,6 +239,28 @@ namespace godot
 		bool add_droplet(DropletBody3D* new_droplet_body);
 		bool remove_droplet(DropletBody3D* old_droplet_body);
 
+		// Adds/removes many droplet bodies at once, returning how many were actually added/removed
+		int32_t add_droplet_bodies(const TypedArray<DropletBody3D>& new_droplet_bodies);
+		int32_t remove_droplet_bodies(const TypedArray<DropletBody3D>& old_droplet_bodies);
+
+		// Adds/removes droplets that only exist in the physics server (they are only drawn when use_multimesh is on)
+		TypedArray<RID> add_droplets(const int32_t count, const PackedVector3Array& positions, const PackedVector3Array& velocities, const int32_t domain = 0);
+		int32_t remove_droplets(const TypedArray<RID>& droplet_rids);
+
+		// Gets the number of droplets in the server, with or without nodes
+		int32_t get_droplet_count() const;
+
+		// Gets/sets which domain a droplet belongs to, by its body's RID (-1/false if it is not in the server)
+		int32_t get_droplet_domain(const RID& droplet_rid) const;
+		bool set_droplet_domain(const RID& droplet_rid, const int32_t domain);
+
+		// Gets the droplets near a droplet, optionally sorted from nearest to farthest
+		TypedArray<DropletBody3D> get_nearby_droplets(DropletBody3D* droplet_body, const bool sorted = false);
+
+		// Gets the latest snapshot of every droplet's ID, position, velocity, and neighbor count (the neighbor counts are
+		// empty unless neighbor_graph_mode is every frame), which can be called from any thread
+		Dictionary get_snapshot() const;
+
 		// Getter and setter for force magnitude
 		float get_force_magnitude() const;
 		void set_force_magnitude(const float force_magnitude);
@@ -89,6 +269,43 @@ namespace godot
 		float get_force_effective_distance() const;
 		void set_force_effective_distance(const float force_effective_distance);
 
+		// Getter and setter for domain count (each domain has its own force magnitude and effective distance, and
+		// domains only attract each other as much as their interaction says, all in the same pair loop)
+		int32_t get_domain_count() const;
+		void set_domain_count(const int32_t domain_count);
+
+		// Getters and setters for each domain's settings, and the interaction between two domains
+		float get_domain_force_magnitude(const int32_t domain) const;
+		void set_domain_force_magnitude(const int32_t domain, const float force_magnitude);
+		float get_domain_effective_distance(const int32_t domain) const;
+		void set_domain_effective_distance(const int32_t domain, const float effective_distance);
+		float get_domain_interaction(const int32_t domain_a, const int32_t domain_b) const;
+		void set_domain_interaction(const int32_t domain_a, const int32_t domain_b, const float interaction);
+
+		// Getter and setter for verlet skin (how much further than the effective distance nearby pairs are looked for,
+		// so they can be reused until some droplet moves more than half the skin, where 0 looks for them every frame)
+		float get_verlet_skin() const;
+		void set_verlet_skin(const float verlet_skin);
+
+		// Getter and setter for force accumulation mode
+		ForceAccumulationMode get_force_accumulation_mode() const;
+		void set_force_accumulation_mode(const ForceAccumulationMode force_accumulation_mode);
+
+		// Getter and setter for kernel precision
+		KernelPrecision get_kernel_precision() const;
+		void set_kernel_precision(const KernelPrecision kernel_precision);
+
+		// Getter for the instruction set the vectorized kernel is using on this CPU
+		String get_kernel_instruction_set() const;
+
+		// Getter and setter for use direct body state
+		bool get_use_direct_body_state() const;
+		void set_use_direct_body_state(const bool use_direct_body_state);
+
+		// Getter and setter for neighbor graph mode
+		NeighborGraphMode get_neighbor_graph_mode() const;
+		void set_neighbor_graph_mode(const NeighborGraphMode neighbor_graph_mode);
+
 		// Solidifies/liquifies the droplets in this server
 		void solidify();
 		void liquefy();
@@ -100,17 +317,150 @@ namespace godot
 		// Getter for whether the droplets are frozen solid
 		bool is_solid() const;
 
+		// Getters and setters for the physical properties of droplets that only exist in the physics server
+		float get_server_droplet_radius() const;
+		void set_server_droplet_radius(const float server_droplet_radius);
+		float get_server_droplet_mass() const;
+		void set_server_droplet_mass(const float server_droplet_mass);
+		float get_server_droplet_friction() const;
+		void set_server_droplet_friction(const float server_droplet_friction);
+		float get_server_droplet_bounce() const;
+		void set_server_droplet_bounce(const float server_droplet_bounce);
+		uint32_t get_server_droplet_collision_layer() const;
+		void set_server_droplet_collision_layer(const uint32_t server_droplet_collision_layer);
+		uint32_t get_server_droplet_collision_mask() const;
+		void set_server_droplet_collision_mask(const uint32_t server_droplet_collision_mask);
+
+		// Getter and setter for publish snapshots (copies the droplets' state at the end of every physics frame, so
+		// that get_snapshot() can be called from other threads without waiting on the simulation)
+		bool get_publish_snapshots() const;
+		void set_publish_snapshots(const bool publish_snapshots);
+
+		// Getter and setter for spatial sort interval (how many physics frames go by between reordering the droplets in
+		// memory so that droplets near each other in space are near each other in memory, where 0 never does)
+		int32_t get_spatial_sort_interval() const;
+		void set_spatial_sort_interval(const int32_t spatial_sort_interval);
+
+		// Getters and setters for dormancy (clusters of droplets that have all been moving slower than the velocity
+		// threshold for the given number of physics frames are left out of the pair loop and allowed to sleep, until a
+		// droplet that is awake comes within the effective distance of them or the physics server wakes one of them)
+		bool get_use_dormancy() const;
+		void set_use_dormancy(const bool use_dormancy);
+		float get_dormancy_velocity_threshold() const;
+		void set_dormancy_velocity_threshold(const float dormancy_velocity_threshold);
+		int32_t get_dormancy_ticks() const;
+		void set_dormancy_ticks(const int32_t dormancy_ticks);
+
+		// Getter and setter for use async forces (computes the forces on worker threads while the physics server
+		// steps, so the physics thread only waits to apply them, but they lag one physics frame behind the positions)
+		bool get_use_async_forces() const;
+		void set_use_async_forces(const bool use_async_forces);
+
+		// Getter and setter for precompute ice groups (keeps the neighbor table and the groups of connected droplets up
+		// to date in every liquid physics frame, from the pairs the force pass finds anyway, so that solidify() only has
+		// to create the ice bodies)
+		bool get_precompute_ice_groups() const;
+		void set_precompute_ice_groups(const bool precompute_ice_groups);
+
+		// Getter and setter for thread count (the number of threads the pair loop runs on, including the physics
+		// thread, where 0 means one per CPU core)
+		int32_t get_thread_count() const;
+		void set_thread_count(const int32_t thread_count);
+
+		// Getter and setter for profiling enabled (off by default, since counting the pairs adds work to the pair loop,
+		// so pairs_tested and pairs_in_range stay at 0 until it is turned on, while the timings are always kept)
+		bool get_profiling_enabled() const;
+		void set_profiling_enabled(const bool profiling_enabled);
+
+		// Gets the latest timings and counts, either all of them or one by name
+		Dictionary get_profile_stats() const;
+		Variant get_profile_stat(const String& stat_name) const;
+
+		// Getter and setter for use multimesh
+		bool get_use_multimesh() const;
+		void set_use_multimesh(const bool use_multimesh);
+
+		// Getter and setter for droplet mesh
+		Ref<Mesh> get_droplet_mesh() const;
+		void set_droplet_mesh(const Ref<Mesh> droplet_mesh);
+
+		// Getter and setter for droplet material
+		Ref<Material> get_droplet_material() const;
+		void set_droplet_material(const Ref<Material> droplet_material);
+
 	private:
-		// Adds droplets recursively to a set (helper for freeze())
-		void add_droplet_to_set(DropletBody3D* droplet_body, DropletSet& droplet_set, Vector3& droplet_set_center);
+		// Adds/takes out a droplet body from the droplet arrays, returning false if it was already added/never added
+		bool insert_droplet_body(DropletBody3D* new_droplet_body);
+		bool erase_droplet_body(DropletBody3D* old_droplet_body);
 
 		// Creates a new ice body, adds it to the array of ice bodies, and returns it
 		IceBody3D* create_ice_body();
 
+		// Freezes/melts a droplet that only exists in the physics server
+		void solidify_server_droplet(const RID& droplet_rid);
+		void liquefy_server_droplet(const RID& droplet_rid, const Transform3D& droplet_transform, const Vector3& droplet_velocity);
+
+		// Reads the position of each droplet into the solver and sorts them into its grid
+		void gather_droplet_positions();
+
+		// Reads the position of each droplet into the solver, without sorting them into its grid
+		void read_droplet_positions();
+
+		// Applies the forces from the solver to each droplet
+		void apply_droplet_forces();
+
+		// Copies the droplets' state into a free snapshot buffer and publishes it
+		void publish_droplet_snapshot();
+
+		// Applies the forces computed in the background since the last physics frame and starts on the next ones
+		void step_forces_async();
+
+		// Rebuilds the neighbor table from the current positions if it is out of date
+		void update_neighbor_table();
+
+		// Creates/destroys the multimesh that draws the droplets, hiding/showing the droplets' own meshes
+		void create_multimesh();
+		void destroy_multimesh();
+
+		// Writes every droplet's transform and solid flag into the multimesh
+		void update_multimesh();
+
+		// Registers/unregisters the profile stats as custom monitors with the Performance singleton
+		void add_profile_monitors();
+		void remove_profile_monitors();
+
+		// Wakes up the dormant clusters that have been disturbed and puts to sleep the clusters that have gone quiet
+		void update_dormancy();
+
+		// Puts a droplet to sleep as part of a dormant cluster, or wakes it back up
+		void put_droplet_to_sleep(uint32_t droplet_index, uint32_t cluster);
+		void wake_droplet(uint32_t droplet_index);
+
+		// Wakes up every dormant droplet
+		void wake_all_droplets();
+
+		// Reorders the droplets along a Morton curve by their last known positions
+		void sort_droplets_spatially();
+
+		// Checks that a domain exists, printing an error if not
+		bool is_valid_domain(const int32_t domain) const;
+
+		// Copies the Verlet rebuild counts from the solver into the profile stats
+		void read_verlet_stats();
+
+		// Gets the number of microseconds since a time point
+		static double usec_since(std::chrono::steady_clock::time_point start);
+
 		// Notification methods
 		void _on_ready();
+		void _on_predelete();
+		void _on_process(double delta);
 		void _on_physics_process(double delta);
 	};
 }
 
+VARIANT_ENUM_CAST(godot::FluidServer::ForceAccumulationMode);
+VARIANT_ENUM_CAST(godot::FluidServer::KernelPrecision);
+VARIANT_ENUM_CAST(godot::FluidServer::NeighborGraphMode);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,20 @@
+#ifndef GODOT_VEC_3_H
+#define GODOT_VEC_3_H
+
+#include <godot_cpp/variant/vector3.hpp>
+
+#include "vec3.h"
+
+// Conversions between the core's Vec3 and Godot's Vector3 (kept out of the core so it does not depend on Godot)
+
+inline Vec3 to_vec3(const godot::Vector3& godot_vector3)
+{
+	return Vec3(godot_vector3.x, godot_vector3.y, godot_vector3.z);
+}
+
+inline godot::Vector3 to_vector3(const Vec3& vec3)
+{
+	return godot::Vector3(vec3.x, vec3.y, vec3.z);
+}
+
+#endif
@@ -1,6 +1,8 @@
 #include "ice_body_3d.h"
 
 #include <godot_cpp/variant/utility_functions.hpp>
+#include <godot_cpp/classes/physics_server3d.hpp>
+#include <godot_cpp/core/error_macros.hpp>
 
 using namespace godot;
 
@@ -12,6 +14,11 @@ void IceBody3D::_bind_methods()
 	ClassDB::bind_method(D_METHOD("set_frozen_droplet_radius", "frozen_droplet_radius"), &IceBody3D::set_frozen_droplet_radius);
 	ClassDB::add_property("IceBody3D", PropertyInfo(Variant::FLOAT, "frozen_droplet_radius"), "set_frozen_droplet_radius", "get_frozen_droplet_radius");
 	
+	// Property: use_collision_shape_nodes
+	ClassDB::bind_method(D_METHOD("get_use_collision_shape_nodes"), &IceBody3D::get_use_collision_shape_nodes);
+	ClassDB::bind_method(D_METHOD("set_use_collision_shape_nodes", "use_collision_shape_nodes"), &IceBody3D::set_use_collision_shape_nodes);
+	ClassDB::add_property("IceBody3D", PropertyInfo(Variant::BOOL, "use_collision_shape_nodes"), "set_use_collision_shape_nodes", "get_use_collision_shape_nodes");
+
 	// Methods: add_droplet and remove_droplet
 	ClassDB::bind_method(D_METHOD("add_droplet", "droplet_body"), &IceBody3D::add_droplet);
 	ClassDB::bind_method(D_METHOD("remove_droplet", "droplet_body"), &IceBody3D::remove_droplet);
@@ -24,33 +31,46 @@ void IceBody3D::_bind_methods()
 // Constructors
 IceBody3D::DropletCollision::DropletCollision() :
 	droplet_body(nullptr),
-	collision_shape(nullptr)
+	droplet_rid(),
+	collision_shape(nullptr),
+	shape_index(-1),
+	local_transform()
+{}
+IceBody3D::DropletCollision::DropletCollision(DropletBody3D* p_droplet_body, const RID& p_droplet_rid, CollisionShape3D* p_collision_shape, const Transform3D& p_local_transform) :
+	droplet_body(p_droplet_body),
+	droplet_rid(p_droplet_rid),
+	collision_shape(p_collision_shape),
+	shape_index(-1),
+	local_transform(p_local_transform)
 {}
-IceBody3D::DropletCollision::DropletCollision(DropletBody3D* p_droplet_body, CollisionShape3D* p_collision_shape) :
+IceBody3D::DropletCollision::DropletCollision(DropletBody3D* p_droplet_body, const RID& p_droplet_rid, int32_t p_shape_index, const Transform3D& p_local_transform) :
 	droplet_body(p_droplet_body),
-	collision_shape(p_collision_shape)
+	droplet_rid(p_droplet_rid),
+	collision_shape(nullptr),
+	shape_index(p_shape_index),
+	local_transform(p_local_transform)
 {}
 
 // Comparison operators
 bool IceBody3D::DropletCollision::operator < (const DropletCollision& other_droplet_collision) const
 {
-	return droplet_body < other_droplet_collision.droplet_body;
+	return droplet_rid.get_id() < other_droplet_collision.droplet_rid.get_id();
 }
 bool IceBody3D::DropletCollision::operator > (const DropletCollision& other_droplet_collision) const
 {
-	return droplet_body > other_droplet_collision.droplet_body;
+	return droplet_rid.get_id() > other_droplet_collision.droplet_rid.get_id();
 }
 bool IceBody3D::DropletCollision::operator == (const DropletCollision& other_droplet_collision) const
 {
-	return droplet_body == other_droplet_collision.droplet_body;
+	return droplet_rid.get_id() == other_droplet_collision.droplet_rid.get_id();
 }
 bool IceBody3D::DropletCollision::operator <= (const DropletCollision& other_droplet_collision) const
 {
-	return droplet_body <= other_droplet_collision.droplet_body;
+	return droplet_rid.get_id() <= other_droplet_collision.droplet_rid.get_id();
 }
 bool IceBody3D::DropletCollision::operator >= (const DropletCollision& other_droplet_collision) const
 {
-	return droplet_body >= other_droplet_collision.droplet_body;
+	return droplet_rid.get_id() >= other_droplet_collision.droplet_rid.get_id();
 }
 
 
@@ -61,6 +81,7 @@ bool IceBody3D::DropletCollision::operator >= (const DropletCollision& other_dro
 IceBody3D::IceBody3D() :
 	m_frozen_droplet_radius(0.5),
 	m_frozen_droplet_collision(nullptr),
+	m_use_collision_shape_nodes(false),
 	m_droplet_collisions(),
 	m_in_game(false)
 {
@@ -135,23 +156,14 @@ bool IceBody3D::add_droplet(DropletBody3D* new_droplet_body)
 
 bool IceBody3D::remove_droplet(DropletBody3D* old_droplet_body)
 {
-	// Try to find it
-	auto found_location = std::find_if(m_droplet_collisions.begin(), m_droplet_collisions.end(), [old_droplet_body] (DropletCollision droplet_collision)
-	{
-		return droplet_collision.droplet_body == old_droplet_body;
-	});
-
-	// Couldn't find it
-	if (found_location == m_droplet_collisions.end())
+	// Try to remove its collision
+	if (!quick_remove_droplet(old_droplet_body->get_rid()))
 	{
 		return false;
 	}
-	// Found it, so remove it
+	// Found it and removed it
 	else
 	{
-		DropletCollision old_droplet_collision = *found_location;
-		old_droplet_collision.collision_shape->queue_free();
-		m_droplet_collisions.erase(found_location);
 		// Update ice mass
 		float old_mass = m_droplet_collisions.size() > 1 ? get_mass() : 0.0;
 		float droplet_mass = old_droplet_body->get_mass();
@@ -169,28 +181,141 @@ bool IceBody3D::remove_droplet(DropletBody3D* old_droplet_body)
 	}
 }
 
+bool IceBody3D::remove_droplet_rid(const RID& old_droplet_rid, float droplet_mass)
+{
+	// Find where the droplet is in the ice body before its collision goes away
+	auto found_location = std::find_if(m_droplet_collisions.begin(), m_droplet_collisions.end(), [&old_droplet_rid] (const DropletCollision& droplet_collision)
+	{
+		return droplet_collision.droplet_rid == old_droplet_rid;
+	});
+	if (found_location == m_droplet_collisions.end())
+		return false;
+	Vector3 droplet_center = found_location->local_transform.origin;
+	quick_remove_droplet(old_droplet_rid);
+	// Nothing is left to update once the last droplet is gone
+	if (m_droplet_collisions.empty())
+		return true;
+	// Update ice mass
+	float old_mass = get_mass();
+	float new_mass = old_mass - droplet_mass;
+	set_mass(new_mass);
+	// Update ice center of mass
+	Vector3 old_center = get_center_of_mass();
+	Vector3 new_center = (old_center * old_mass - droplet_center * droplet_mass) / new_mass;
+	set_center_of_mass(new_center);
+	return true;
+}
+
 // Adds a droplet to the ice body without any safety checks or property updates
 
 void IceBody3D::quick_add_droplet(DropletBody3D* new_droplet_body)
 {
-	// Add it as a child
-	if (UtilityFunctions::is_instance_valid(new_droplet_body->get_parent()))
+	// The droplet stays where it is in the scene tree (reparenting every droplet would cause a hitch), so
+	// only give it a parent if it does not have one
+	if (!UtilityFunctions::is_instance_valid(new_droplet_body->get_parent()))
 	{
-		new_droplet_body->reparent(this, true);
+		add_child(new_droplet_body);
 		new_droplet_body->set_owner(get_owner());
 	}
+	// Remember where the droplet is relative to the ice body, so it can follow the ice body around
+	Transform3D local_transform = get_global_transform().affine_inverse() * new_droplet_body->get_global_transform();
+	// Create a new collision shape node corresponding to the droplet
+	if (m_use_collision_shape_nodes)
+	{
+		CollisionShape3D* new_collision_shape = Object::cast_to<CollisionShape3D>(m_frozen_droplet_collision->duplicate());
+		add_child(new_collision_shape);
+		new_collision_shape->set_owner(get_owner());
+		new_collision_shape->set_global_position(new_droplet_body->get_global_position());
+		// Add them to the set
+		m_droplet_collisions.push_back(DropletCollision(new_droplet_body, new_droplet_body->get_rid(), new_collision_shape, local_transform));
+	}
+	// Or add the shared sphere shape straight to this body
 	else
 	{
-		add_child(new_droplet_body);
-		new_droplet_body->set_owner(get_owner());
+		int32_t shape_index = add_droplet_shape(local_transform);
+		// Add them to the set
+		m_droplet_collisions.push_back(DropletCollision(new_droplet_body, new_droplet_body->get_rid(), shape_index, local_transform));
+	}
+}
+
+void IceBody3D::quick_add_droplet_rid(const RID& new_droplet_rid, const Transform3D& droplet_transform)
+{
+	// There is no node to duplicate a collision shape from, so the shape always goes through the physics server
+	Transform3D local_transform = get_global_transform().affine_inverse() * droplet_transform;
+	int32_t shape_index = add_droplet_shape(local_transform);
+	m_droplet_collisions.push_back(DropletCollision(nullptr, new_droplet_rid, shape_index, local_transform));
+}
+
+// Removes a droplet's collision from the ice body without any property updates
+
+bool IceBody3D::quick_remove_droplet(const RID& old_droplet_rid)
+{
+	// Try to find it
+	auto found_location = std::find_if(m_droplet_collisions.begin(), m_droplet_collisions.end(), [&old_droplet_rid] (const DropletCollision& droplet_collision)
+	{
+		return droplet_collision.droplet_rid == old_droplet_rid;
+	});
+	// Couldn't find it
+	if (found_location == m_droplet_collisions.end())
+		return false;
+	// Found it, so remove it
+	DropletCollision old_droplet_collision = *found_location;
+	m_droplet_collisions.erase(found_location);
+	// Remove its collision
+	if (old_droplet_collision.collision_shape != nullptr)
+	{
+		old_droplet_collision.collision_shape->queue_free();
+	}
+	else
+	{
+		PhysicsServer3D::get_singleton()->body_remove_shape(get_rid(), old_droplet_collision.shape_index);
+		// The physics server shifts the shapes after the removed one down by one
+		for (DropletCollision& droplet_collision : m_droplet_collisions)
+		{
+			if (droplet_collision.shape_index > old_droplet_collision.shape_index)
+				--droplet_collision.shape_index;
+		}
+	}
+	return true;
+}
+
+// Adds the shared sphere shape straight to this body, offset to where the droplet is, and returns its index
+int32_t IceBody3D::add_droplet_shape(const Transform3D& local_transform)
+{
+	PhysicsServer3D* physics_server = PhysicsServer3D::get_singleton();
+	int32_t shape_index = physics_server->body_get_shape_count(get_rid());
+	Transform3D shape_transform = Transform3D(Basis(), local_transform.origin);
+	physics_server->body_add_shape(get_rid(), m_frozen_droplet_shape->get_rid(), shape_transform);
+	return shape_index;
+}
+
+// Moves the droplets so that they follow the ice body, using the offsets they had when they were added
+
+void IceBody3D::update_droplet_transforms()
+{
+	Transform3D ice_transform = get_global_transform();
+	for (DropletCollision& droplet_collision : m_droplet_collisions)
+	{
+		// Droplets without nodes have nothing to draw, so they are only moved when they melt
+		if (droplet_collision.droplet_body != nullptr)
+		{
+			droplet_collision.droplet_body->set_global_transform(ice_transform * droplet_collision.local_transform);
+		}
 	}
-	// Create a new collision shape corresponding to the droplet
-	CollisionShape3D* new_collision_shape = Object::cast_to<CollisionShape3D>(m_frozen_droplet_collision->duplicate());
-	add_child(new_collision_shape);
-	new_collision_shape->set_owner(get_owner());
-	new_collision_shape->set_global_position(new_droplet_body->get_global_position());
-	// Add them to the set
-	m_droplet_collisions.push_back(DropletCollision(new_droplet_body, new_collision_shape));
+}
+
+// Getters and setters for use collision shape nodes
+
+bool IceBody3D::get_use_collision_shape_nodes() const
+{
+	return m_use_collision_shape_nodes;
+}
+
+void IceBody3D::set_use_collision_shape_nodes(const bool use_collision_shape_nodes)
+{
+	// Shapes added either way share the body's shape indices, so the two must never be mixed
+	ERR_FAIL_COND_MSG(!m_droplet_collisions.empty(), "use_collision_shape_nodes can only be changed while the ice body has no droplets.");
+	m_use_collision_shape_nodes = use_collision_shape_nodes;
 }
 
 // Getters and setters for frozen droplet radius
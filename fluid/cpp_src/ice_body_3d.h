@@ -24,12 +24,16 @@ namespace godot
 		// A struct holding information about a droplet and its corresponding collision
 		struct DropletCollision
 		{
-			// Properties
+			// Properties (the droplet body is null for droplets that only exist in the physics server)
 			DropletBody3D* droplet_body;
+			RID droplet_rid;
 			CollisionShape3D* collision_shape;
+			int32_t shape_index;
+			Transform3D local_transform;
 			// Constructors
 			DropletCollision();
-			DropletCollision(DropletBody3D* p_droplet_body, CollisionShape3D* p_collision_shape);
+			DropletCollision(DropletBody3D* p_droplet_body, const RID& p_droplet_rid, CollisionShape3D* p_collision_shape, const Transform3D& p_local_transform);
+			DropletCollision(DropletBody3D* p_droplet_body, const RID& p_droplet_rid, int32_t p_shape_index, const Transform3D& p_local_transform);
 			// Comparison operators
 			bool operator < (const DropletCollision& other_droplet_collision) const;
 			bool operator > (const DropletCollision& other_droplet_collision) const;
@@ -43,6 +47,10 @@ namespace godot
 		CollisionShape3D* m_frozen_droplet_collision;
 		Ref<SphereShape3D> m_frozen_droplet_shape;
 
+		// Whether each droplet gets its own CollisionShape3D node (easier to inspect in the editor), rather than
+		// a shape added straight to this body in the physics server (should be set before any droplets are added)
+		bool m_use_collision_shape_nodes;
+
 		// A dynamic array of the droplets in the ice body along with their corresponding collisions
 		std::vector<DropletCollision> m_droplet_collisions;
 
@@ -65,13 +73,35 @@ namespace godot
 		float get_frozen_droplet_radius() const;
 		void set_frozen_droplet_radius(const float frozen_droplet_radius);
 
+		// Getter and setter for use collision shape nodes
+		bool get_use_collision_shape_nodes() const;
+		void set_use_collision_shape_nodes(const bool use_collision_shape_nodes);
+
 		// Adds/removes a droplet from the ice body
 		bool add_droplet(DropletBody3D* new_droplet_body);
 		bool remove_droplet(DropletBody3D* old_droplet_body);
 
+		// Moves the droplets so that they follow the ice body
+		void update_droplet_transforms();
+
 	private:
 		// Adds a droplet to the ice body without any safety checks or property updates
 		void quick_add_droplet(DropletBody3D* new_droplet_body);
+
+		// Adds a droplet that only exists in the physics server, given its global transform, without any safety
+		// checks or property updates
+		void quick_add_droplet_rid(const RID& new_droplet_rid, const Transform3D& droplet_transform);
+
+		// Removes a droplet's collision from the ice body without any property updates, returning false if the
+		// droplet is not in the ice body
+		bool quick_remove_droplet(const RID& old_droplet_rid);
+
+		// Removes a droplet that only exists in the physics server, given its mass, updating the mass and center of
+		// mass like remove_droplet() (returns false if the droplet is not in the ice body)
+		bool remove_droplet_rid(const RID& old_droplet_rid, float droplet_mass);
+
+		// Adds a shape for a droplet straight to this body in the physics server and returns its index
+		int32_t add_droplet_shape(const Transform3D& local_transform);
 	};
 }
 